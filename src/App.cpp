@@ -1,14 +1,17 @@
 #include "App.h"
 #include "MyScreen.h"
 #include "oglwidget.h"
-#include "usvdata/InputUtils.h"
+#include "usvdata/CaseCache.h"
 #include "usvdata/UsvRun.h"
 #include "ui/IgnorantTextBox.h"
+#include "ui/LogWindow.h"
 #include "ui/ScrollableSlider.h"
 #include "ui/SettingsWindow.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 
-#define USV_GUI_USV_EXECUTABLE_ENV_NAME "USV_GUI_USV_EXECUTABLE"
+#define USV_GUI_USV_TIMEOUT_ENV_NAME "USV_GUI_USV_TIMEOUT"
 
 void App::run() {
     load_directory(std::filesystem::current_path().string());
@@ -16,6 +19,7 @@ void App::run() {
     while (!glfwWindowShouldClose(window)) {
         // Check if any events have been activated (key pressed, mouse moved etc.) and call corresponding response functions
         glfwWaitEvents();
+        process_events();
         // Draw nanogui
         screen->draw_all();
     }
@@ -97,63 +101,57 @@ void App::initialize_gui() {
 
 void App::load_directory(const std::string& data_directory) {
     try {
-        screen->map().loadData(std::make_unique<USV::CaseData>(USV::InputUtils::loadInputData(data_directory)));
+        screen->map().loadData(USV::CaseCache::loadCase(data_directory));
         update_time(screen->map().case_data()->min_time);
         if (slider)
             slider->set_value(0);
         glfwSetWindowTitle(window, data_directory.c_str());
         if (run_usv_button)
             run_usv_button->set_enabled(usv_runner != nullptr);
+        watch_directory(data_directory);
     } catch (std::runtime_error& e) {
         std::cout << "Couldn't open: " << e.what() << std::endl;
     }
 }
 
-namespace {
-    void
-    push_position(double time, const USV::Path& path, std::vector<Vessel>& vessels, double radius, Vessel::Type type, const USV::Ship* ship) {
-        try {
-            auto position = path.position(time);
-            Vessel v{ship, position.point, position.course.radians(), radius, type};
-            vessels.push_back(v);
-        } catch (std::out_of_range&) {}
+void App::watch_directory(const std::filesystem::path& data_directory) {
+    if (case_watcher && case_watcher->directory() == data_directory) return;
+    case_watcher.reset();
+    try {
+        case_watcher = std::make_unique<USV::FileWatcher>(data_directory, [this](
+                const std::vector<std::string>& filenames) {
+            post([this, filenames] { reload_changed(filenames); });
+        });
+    } catch (std::runtime_error& e) {
+        // Reload button still works
+        std::cout << "Couldn't watch case directory: " << e.what() << std::endl;
     }
 }
 
-void App::update_time(double time) {
-    std::vector<Vessel> vessels;
+void App::reload_changed(const std::vector<std::string>& filenames) {
     auto& map = screen->map();
     auto case_data = map.case_data();
-    vessels.reserve(case_data->paths.size());
-    for (const auto& pe: case_data->paths) {
-        Vessel::Type type;
-        switch (pe.pathType) {
-            case USV::PathType::TargetManeuver:
-                if (pe.ship->target_status == nullptr) {
-                    type = Vessel::Type::TargetUndefined;
-                } else {
-                    type = static_cast<Vessel::Type>(pe.ship->target_status->danger_level);
-                }
-                break;
-            case USV::PathType::WastedManeuver:
-                type = Vessel::Type::ShipOnWastedManeuver;
-                break;
-            case USV::PathType::ShipManeuver:
-                type = Vessel::Type::ShipOnManeuver;
-                break;
-            case USV::PathType::Route:
-                type = Vessel::Type::ShipOnRoute;
-                break;
-            case USV::PathType::End:
-                type = Vessel::Type::TargetUndefined;
-                break;
-        }
-        push_position(time, pe.path, vessels, case_data->radius, type, pe.ship);
+    if (!case_data) return;
+    const auto changes = USV::CaseCache::changesOf(*case_data, filenames);
+    if (changes.empty()) return;
+    if (changes.reload) {
+        reload();
+        return;
+    }
+    try {
+        map.reloadChanged(changes);
+        // Time range may have changed with paths, keep slider position
+        const auto value = slider ? slider->value() : 0.0f;
+        update_time(case_data->min_time + (case_data->max_time - case_data->min_time) * value);
+    } catch (std::runtime_error& e) {
+        std::cout << "Couldn't reload changed files: " << e.what() << std::endl;
     }
+}
 
-    map.updatePositions(vessels);
-    map.updateTime(time / 3600);
-    map.updateSunAngle(static_cast<long>(time), case_data->frame.getRefLat(), case_data->frame.getRefLon());
+void App::update_time(double time) {
+    auto& map = screen->map();
+    auto case_data = map.case_data();
+    map.updateCaseTime(time);
 
     if (time_label) {
         time_t seconds = static_cast<time_t>(time) - case_data->start_time;
@@ -177,11 +175,80 @@ void App::reload() {
 }
 
 void App::run_case() {
+    if (!usv_runner) return;
+    if (usv_runner->running()) {
+        usv_runner->cancel();
+        if (w_log) w_log->setStatus("Cancelling...");
+        return;
+    }
     auto case_data = screen->map().case_data();
-    if (usv_runner && case_data && !case_data->directory.empty()) {
-        usv_runner->run(case_data->directory, case_data->data_filenames);
-        load_directory(case_data->directory.string());
+    if (!case_data || case_data->directory.empty()) return;
+
+    double timeout = 0;
+    if (const char* timeout_env = std::getenv(USV_GUI_USV_TIMEOUT_ENV_NAME))
+        timeout = std::max(0.0, std::atof(timeout_env));
+
+    show_log();
+    w_log->clear();
+    w_log->setStatus("Running...");
+    auto directory = case_data->directory;
+    auto on_output = [this](USV::USVRunner::Stream stream, const std::string& chunk) {
+        post([this, stream, chunk] { w_log->append(stream, chunk); });
+    };
+    auto on_finish = [this, directory](const USV::USVRunner::Result& result) {
+        post([this, directory, result] {
+            w_log->flush();
+            if (!result.error.empty())
+                w_log->setStatus(result.error);
+            else if (result.cancelled)
+                w_log->setStatus("Cancelled");
+            else if (result.timed_out)
+                w_log->setStatus("Timed out");
+            else
+                w_log->setStatus("Exit code " + std::to_string(result.exit_code) + (result.cached ? " (cached)" : ""));
+            set_running(false);
+            // Written outputs are picked up by case watcher, without it reload the whole case
+            if (!case_watcher) load_directory(directory.string());
+        });
+    };
+    if (usv_runner->start(directory, case_data->data_filenames, on_output, on_finish, timeout))
+        set_running(true);
+}
+
+void App::set_running(bool running) {
+    if (run_usv_button) {
+        run_usv_button->set_caption(running ? "Cancel" : "Run");
+        run_usv_button->set_icon(running ? FA_STOP : FA_BRAIN);
+    }
+    if (w_log) w_log->setRunning(running);
+    screen->perform_layout();
+}
+
+void App::show_log() {
+    if (!w_log) {
+        w_log = new LogWindow(screen);
+        w_log->setCancelCallback([this] { if (usv_runner) usv_runner->cancel(); });
+        w_log->set_position({10, 50});
+    }
+    w_log->set_visible(true);
+    screen->perform_layout();
+}
+
+void App::post(std::function<void()> event) {
+    {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        pending_events.push_back(std::move(event));
+    }
+    glfwPostEmptyEvent();
+}
+
+void App::process_events() {
+    std::vector<std::function<void()>> events;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.swap(pending_events);
     }
+    for (auto& event: events) event();
 }
 
 void App::open() {
@@ -317,7 +384,7 @@ namespace {
 
     void save_usv_exec_path(std::string& path) {
         std::ofstream myfile;
-        myfile.open(USV_GUI_USV_EXECUTABLE_ENV_NAME);
+        myfile.open(App::usv_executable_filename);
         myfile << path;
         myfile.close();
     }
@@ -325,7 +392,7 @@ namespace {
     std::string get_usv_exec_path() {
         std::string path;
         std::ifstream myfile;
-        myfile.open(USV_GUI_USV_EXECUTABLE_ENV_NAME);
+        myfile.open(App::usv_executable_filename);
         if (myfile.good()) {
             myfile >> path;
             myfile.close();
@@ -340,6 +407,7 @@ namespace {
 void App::select_usv_executable() {
     auto executable = special_file_dialog({});
     if (!executable.empty()) {
+        // Old runner cancels its run and waits for it, finish event is still posted
         usv_runner = std::make_unique<USV::USVRunner>(executable);
         save_usv_exec_path(executable);
         if (run_usv_button)
@@ -412,6 +480,10 @@ void App::FramebufferSizeCallback(GLFWwindow* window, int width, int height) {
 }
 
 App::~App() {
+    // Stop solver and watcher before their callbacks could touch destroyed widgets
+    usv_runner.reset();
+    case_watcher.reset();
+    pending_events.clear();
     delete screen;
 }
 
@@ -1,15 +1,20 @@
 #ifndef USV_GUI_APP_H
 #define USV_GUI_APP_H
 
+#include "usvdata/FileWatcher.h"
 #include "usvdata/UsvRun.h"
 #include <GLFW/glfw3.h>
+#include <functional>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <nanogui/window.h>
 
 class MyScreen;
 class ScrollableSlider;
 class IgnorantTextBox;
+class LogWindow;
 namespace nanogui {
     class Button;
 }
@@ -23,8 +28,19 @@ class App {
     //ui
     IgnorantTextBox* time_label{};
     nanogui::Window* w_settings{};
+    LogWindow* w_log{};
+
+    // Work posted from other threads, run on main loop
+    std::mutex events_mutex;
+    std::vector<std::function<void()>> pending_events;
+
+    // Declared after events, their threads post them until joined
     std::unique_ptr<USV::USVRunner> usv_runner{};
+    std::unique_ptr<USV::FileWatcher> case_watcher{};
 public:
+    //! File in working directory the solver executable selected in GUI is stored in
+    static constexpr const char* usv_executable_filename = "USV_GUI_USV_EXECUTABLE";
+
     explicit App(GLFWwindow* glfw_window);
 
     ~App();
@@ -38,6 +54,24 @@ private:
 
     void load_directory(const std::string& data_directory);
 
+    void watch_directory(const std::filesystem::path& data_directory);
+
+    /**
+     * \brief Reloads changed files of open case, only parts of case depending on them
+     */
+    void reload_changed(const std::vector<std::string>& filenames);
+
+    /**
+     * \brief Queues callback to run on main thread and wakes the main loop. Thread safe.
+     */
+    void post(std::function<void()> event);
+
+    void process_events();
+
+    void show_log();
+
+    void set_running(bool running);
+
     void update_time(double time);
 
     void reload();
@@ -4,6 +4,10 @@
 #define USV_GUI_MATRICES_BINDING 16
 #define USV_GUI_LIGHTS_BINDING 17
 
+// Texture units, 0 is left to nanovg
+#define USV_GUI_PATH_TABLE_UNIT 1
+#define USV_GUI_SEGMENT_TABLE_UNIT 2
+
 struct Material{
     glm::vec3 ambient;
     glm::vec3 diffuse;
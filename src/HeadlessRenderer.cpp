@@ -0,0 +1,418 @@
+#include "HeadlessRenderer.h"
+#include "Program.h"
+#include "oglwidget.h"
+#include "usvdata/CaseCache.h"
+#include <nanovg_gl.h>
+
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// Number of pixel pack buffers frames are cycled through
+#define READBACK_PBO_N 3
+
+namespace {
+    // BEGIN PNG WRITER
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const auto table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1u) ? 0xEDB88320u ^ (c >> 1u) : c >> 1u;
+                t[n] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8u);
+        return ~crc;
+    }
+
+    void put_u32_be(std::vector<uint8_t>& out, uint32_t v) {
+        out.push_back(static_cast<uint8_t>(v >> 24u));
+        out.push_back(static_cast<uint8_t>(v >> 16u));
+        out.push_back(static_cast<uint8_t>(v >> 8u));
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    void put_chunk(std::ofstream& ofs, const char* type, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+        put_u32_be(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        put_u32_be(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        ofs.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    /**
+     * Write RGBA image as RGB PNG. Image data is stored deflated with no compression,
+     * encoding speed matters more than size here.
+     * @param rgba Bottom-up rows as returned by glReadPixels
+     */
+    bool write_png(const std::filesystem::path& filename, const std::vector<uint8_t>& rgba, int width, int height) {
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs.good()) return false;
+        static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        ofs.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> ihdr;
+        put_u32_be(ihdr, static_cast<uint32_t>(width));
+        put_u32_be(ihdr, static_cast<uint32_t>(height));
+        ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, deflate, no filter, no interlace
+        put_chunk(ofs, "IHDR", ihdr);
+
+        // Raw scanlines: filter byte followed by RGB triplets, top row first
+        const size_t row_size = 1 + 3 * static_cast<size_t>(width);
+        std::vector<uint8_t> raw(row_size * static_cast<size_t>(height));
+        for (int y = 0; y < height; ++y) {
+            auto* dst = raw.data() + row_size * y;
+            const auto* src = rgba.data() + 4 * static_cast<size_t>(width) * (height - 1 - y);
+            *dst++ = 0;
+            for (int x = 0; x < width; ++x, src += 4) {
+                *dst++ = src[0];
+                *dst++ = src[1];
+                *dst++ = src[2];
+            }
+        }
+
+        // zlib stream of stored blocks
+        std::vector<uint8_t> idat;
+        idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+        uint32_t a = 1, b = 0;
+        for (size_t pos = 0;;) {
+            const auto len = static_cast<uint16_t>(std::min<size_t>(65535, raw.size() - pos));
+            const bool last = pos + len >= raw.size();
+            idat.push_back(last ? 1 : 0);
+            idat.push_back(static_cast<uint8_t>(len));
+            idat.push_back(static_cast<uint8_t>(len >> 8u));
+            idat.push_back(static_cast<uint8_t>(~len));
+            idat.push_back(static_cast<uint8_t>(static_cast<uint16_t>(~len) >> 8u));
+            for (size_t i = pos; i < pos + len; ++i) {
+                a = (a + raw[i]) % 65521;
+                b = (b + a) % 65521;
+            }
+            idat.insert(idat.end(), raw.begin() + static_cast<ptrdiff_t>(pos),
+                        raw.begin() + static_cast<ptrdiff_t>(pos + len));
+            pos += len;
+            if (last) break;
+        }
+        put_u32_be(idat, (b << 16u) | a);
+        put_chunk(ofs, "IDAT", idat);
+        put_chunk(ofs, "IEND", {});
+        return ofs.good();
+    }
+    // END PNG WRITER
+
+    class EncoderPool {
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool stop{false};
+    public:
+        explicit EncoderPool(unsigned n) {
+            for (unsigned i = 0; i < std::max(n, 1u); ++i)
+                threads.emplace_back([this] {
+                    for (;;) {
+                        std::function<void()> job;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            cv.wait(lock, [this] { return stop || !jobs.empty(); });
+                            if (jobs.empty()) return;
+                            job = std::move(jobs.front());
+                            jobs.pop_front();
+                        }
+                        job();
+                    }
+                });
+        }
+
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            cv.notify_one();
+        }
+
+        /**
+         * Finish all submitted jobs and stop threads
+         */
+        void join() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cv.notify_all();
+            for (auto& t: threads) t.join();
+            threads.clear();
+        }
+
+        ~EncoderPool() {
+            join();
+        }
+    };
+
+    class EGLOffscreenContext {
+        EGLDisplay display{EGL_NO_DISPLAY};
+        EGLSurface surface{EGL_NO_SURFACE};
+        EGLContext context{EGL_NO_CONTEXT};
+    public:
+        EGLOffscreenContext() {
+            auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+            if (get_platform_display)
+                display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display == EGL_NO_DISPLAY)
+                display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            EGLint major, minor;
+            if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+                throw std::runtime_error("Could not initialize EGL display");
+            if (!eglBindAPI(EGL_OPENGL_API))
+                throw std::runtime_error("EGL has no desktop OpenGL support");
+
+            // Prefer pbuffer capable config, surfaceless displays may have none
+            EGLConfig config;
+            EGLint num_configs = 0;
+            EGLint config_attribs[] = {
+                    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+                    EGL_NONE
+            };
+            if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0) {
+                config_attribs[1] = 0;
+                if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+                    throw std::runtime_error("No suitable EGL config");
+            } else {
+                const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+                surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+            }
+
+            const EGLint context_attribs[] = {
+                    EGL_CONTEXT_MAJOR_VERSION, 3,
+                    EGL_CONTEXT_MINOR_VERSION, 3,
+                    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                    EGL_NONE
+            };
+            context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+            if (context == EGL_NO_CONTEXT)
+                throw std::runtime_error("Could not create OpenGL 3.3 core context");
+            if (!eglMakeCurrent(display, surface, surface, context))
+                throw std::runtime_error("Could not make EGL context current");
+        }
+
+        ~EGLOffscreenContext() {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+            if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+            eglTerminate(display);
+        }
+    };
+
+    const char* const default_fonts[] = {
+            "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+            "/usr/share/fonts/TTF/DejaVuSans.ttf",
+            "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+            "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+    };
+}
+
+bool HeadlessRenderer::parseTimes(const std::string& value, Options& options) {
+    auto first = value.find(':');
+    auto second = first == std::string::npos ? std::string::npos : value.find(':', first + 1);
+    if (second == std::string::npos) return false;
+    try {
+        auto t0 = value.substr(0, first);
+        auto t1 = value.substr(first + 1, second - first - 1);
+        auto step = value.substr(second + 1);
+        if (!t0.empty()) options.start_time = std::stod(t0);
+        if (!t1.empty()) options.end_time = std::stod(t1);
+        if (!step.empty()) options.step = std::stod(step);
+    } catch (std::logic_error&) {
+        return false;
+    }
+    return options.step > 0;
+}
+
+int HeadlessRenderer::render(const Options& options) {
+    const auto width = options.width;
+    const auto height = options.height;
+    std::unique_ptr<USV::CaseData> case_data;
+    try {
+        case_data = USV::CaseCache::loadCase(options.case_directory);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Couldn't open: " << e.what() << std::endl;
+        return 1;
+    }
+    const auto t0 = std::isnan(options.start_time) ? case_data->min_time : options.start_time;
+    const auto t1 = std::isnan(options.end_time) ? case_data->max_time : options.end_time;
+
+    std::error_code ec;
+    std::filesystem::create_directories(options.output_directory, ec);
+
+    std::unique_ptr<EGLOffscreenContext> egl;
+    try {
+        egl = std::make_unique<EGLOffscreenContext>();
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+#if defined(NANOGUI_GLAD)
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        std::cerr << "Could not initialize GLAD!" << std::endl;
+        return 1;
+    }
+    glGetError(); // pull and ignore unhandled errors like GL_INVALID_ENUM
+#endif
+
+    // Offscreen framebuffer. Stencil is required for isles masking.
+    GLuint fbo, color_rb, depth_rb;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &color_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+    glGenRenderbuffers(1, &depth_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+        return 1;
+    }
+
+    const auto frame_size = static_cast<GLsizeiptr>(4) * width * height;
+    std::array<GLuint, READBACK_PBO_N> pbos{};
+    glGenBuffers(READBACK_PBO_N, pbos.data());
+    for (auto pbo: pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    auto nvg = nvgCreateGL3(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+    {
+        int font = -1;
+        if (!options.font.empty()) {
+            font = nvgCreateFont(nvg, "sans", options.font.c_str());
+        } else {
+            for (auto path: default_fonts)
+                if (std::filesystem::exists(path) && (font = nvgCreateFont(nvg, "sans", path)) != -1) break;
+        }
+        if (font == -1)
+            std::cerr << "No font loaded, captions will be omitted" << std::endl;
+    }
+
+    int exit_code = 0;
+    {
+        OGLWidget map;
+        map.resizeGL(width, height);
+        map.initializeGL();
+        map.loadData(std::move(case_data));
+
+        EncoderPool encoders(options.workers ? options.workers : std::thread::hardware_concurrency());
+        std::mutex failed_mutex;
+        std::vector<std::filesystem::path> failed;
+
+        // Frames which pixels are in flight: pbo index -> file name
+        std::deque<std::pair<size_t, std::filesystem::path>> pending;
+        // Set when pixels of a frame can't be read back, rendering stops then
+        bool readback_failed = false;
+        auto collect = [&] {
+            auto [pbo_index, filename] = pending.front();
+            pending.pop_front();
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pbo_index]);
+            auto* mapped = static_cast<const uint8_t*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+            if (!mapped) {
+                std::cerr << "Failed to map pixels of " << filename << ", GL error 0x" << std::hex << glGetError()
+                          << std::dec << std::endl;
+                readback_failed = true;
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                return;
+            }
+            auto pixels = std::make_shared<std::vector<uint8_t>>(mapped, mapped + frame_size);
+            // Contents are undefined if the buffer was lost while mapped
+            const bool intact = glUnmapBuffer(GL_PIXEL_PACK_BUFFER) == GL_TRUE;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            if (!intact) {
+                std::cerr << "Pixels of " << filename << " were lost during readback" << std::endl;
+                readback_failed = true;
+                return;
+            }
+            encoders.submit([pixels, filename = std::move(filename), width, height, &failed, &failed_mutex] {
+                if (!write_png(filename, *pixels, width, height)) {
+                    std::lock_guard<std::mutex> lock(failed_mutex);
+                    failed.push_back(filename);
+                }
+            });
+        };
+
+        size_t frame = 0;
+        for (double t = t0; !readback_failed && t <= t1; t = t0 + options.step * static_cast<double>(++frame)) {
+            map.updateCaseTime(t);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glViewport(0, 0, width, height);
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            nvgBeginFrame(nvg, static_cast<float>(width), static_cast<float>(height), 1.0f);
+            map.paintGL(nvg);
+            nvgEndFrame(nvg);
+
+            if (pending.size() == READBACK_PBO_N) collect();
+            const auto pbo_index = frame % READBACK_PBO_N;
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pbo_index]);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%06zu.png", frame);
+            pending.emplace_back(pbo_index, options.output_directory / name);
+        }
+        while (!readback_failed && !pending.empty()) collect();
+        if (readback_failed) {
+            exit_code = 1;
+        } else {
+            std::cout << "Rendered " << frame << " frames to " << options.output_directory << std::endl;
+        }
+
+        encoders.join();
+        for (const auto& f: failed) {
+            std::cerr << "Failed to write " << f << std::endl;
+            exit_code = 1;
+        }
+    }
+
+    nvgDeleteGL3(nvg);
+    glDeleteBuffers(READBACK_PBO_N, pbos.data());
+    glDeleteRenderbuffers(1, &depth_rb);
+    glDeleteRenderbuffers(1, &color_rb);
+    glDeleteFramebuffers(1, &fbo);
+    return exit_code;
+}
@@ -0,0 +1,43 @@
+#ifndef USV_GUI_HEADLESSRENDERER_H
+#define USV_GUI_HEADLESSRENDERER_H
+
+#include <filesystem>
+#include <limits>
+#include <string>
+
+/**
+ * Renders case frames to PNG files without any window or UI.
+ * OpenGL context is created through EGL (surfaceless Mesa platform when available),
+ * so it works on GPU-less machines with llvmpipe.
+ */
+class HeadlessRenderer {
+public:
+    struct Options {
+        std::string case_directory;
+        //! Time range [sec]. NaN means case bounds.
+        double start_time{std::numeric_limits<double>::quiet_NaN()};
+        double end_time{std::numeric_limits<double>::quiet_NaN()};
+        double step{60};
+        std::filesystem::path output_directory;
+        int width{1280};
+        int height{720};
+        //! Number of PNG encoding threads. 0 means hardware concurrency.
+        unsigned workers{0};
+        //! TTF font for captions. Empty means first of well-known system fonts.
+        std::string font;
+    };
+
+    /**
+     * Parse `--times t0:t1:step` value. Empty t0 or t1 keeps case bounds.
+     * @return false if value is malformed
+     */
+    static bool parseTimes(const std::string& value, Options& options);
+
+    /**
+     * Render frames of a case
+     * @return Process exit code
+     */
+    static int render(const Options& options);
+};
+
+#endif //USV_GUI_HEADLESSRENDERER_H
@@ -0,0 +1,175 @@
+#include "PathBuffer.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+namespace {
+    constexpr size_t vertex_size = 2 * sizeof(GLfloat);
+    constexpr size_t no_offset = std::numeric_limits<size_t>::max();
+}
+
+PathBuffer::PathBuffer(std::vector<GLfloat> prefix) : prefix_count(prefix.size() / 2) {
+    glGenBuffers(1, &buffer);
+    capacity = prefix_count;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(capacity * vertex_size), prefix.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+PathBuffer::~PathBuffer() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void PathBuffer::bind() const {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void PathBuffer::release() {
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+const std::vector<PathBuffer::Range>& PathBuffer::update(const std::vector<USV::PathEnvelope>& paths) {
+    // Free ranges of paths that are gone first, so new paths can take them
+    std::unordered_set<uint64_t> ids;
+    ids.reserve(paths.size());
+    for (const auto& pe: paths) ids.insert(pe.id);
+    for (auto it = allocations.begin(); it != allocations.end();) {
+        if (ids.count(it->first)) {
+            ++it;
+        } else {
+            free(it->second);
+            it = allocations.erase(it);
+        }
+    }
+
+    // Place new paths into free ranges, then grow buffer once for those that don't fit any of them
+    std::vector<std::pair<const USV::PathEnvelope*, size_t>> fresh;
+    std::vector<const USV::PathEnvelope*> overflow;
+    size_t overflow_count = 0;
+    for (const auto& pe: paths) {
+        if (allocations.count(pe.id)) continue;
+        const auto count = pe.path.pointsPathCount();
+        fresh.emplace_back(&pe, count);
+        const auto offset = allocate(count);
+        if (offset == no_offset) {
+            overflow.push_back(&pe);
+            overflow_count += count;
+        } else {
+            allocations.emplace(pe.id, Allocation{offset, count});
+        }
+    }
+    if (!overflow.empty()) {
+        // Free range at the end is extended, overflow paths are placed one after another in it
+        size_t tail_free = 0;
+        if (!free_ranges.empty()) {
+            const auto last = std::prev(free_ranges.end());
+            if (last->first + last->second == capacity) tail_free = last->second;
+        }
+        const auto old_capacity = capacity;
+        reserve(std::max(capacity + overflow_count - tail_free, capacity + capacity / 2));
+        free(Allocation{old_capacity, capacity - old_capacity});
+        for (const auto* pe: overflow) {
+            const auto count = pe->path.pointsPathCount();
+            allocations.emplace(pe->id, Allocation{allocate(count), count});
+        }
+    }
+    size_t write_begin = no_offset, write_end = 0;
+    for (const auto& [pe, count]: fresh) {
+        const auto offset = allocations.at(pe->id).offset;
+        write_begin = std::min(write_begin, offset);
+        write_end = std::max(write_end, offset + count);
+    }
+
+    // Write them through one mapping of the span they occupy, flushing only written ranges
+    if (write_end > write_begin) {
+        bind();
+        auto* mapped = static_cast<GLfloat*>(glMapBufferRange(
+                GL_ARRAY_BUFFER, static_cast<GLintptr>(write_begin * vertex_size),
+                static_cast<GLsizeiptr>((write_end - write_begin) * vertex_size),
+                GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+        if (mapped) {
+            for (const auto& fresh_path: fresh) {
+                const auto* pe = fresh_path.first;
+                const auto& allocation = allocations.at(pe->id);
+                const auto relative = allocation.offset - write_begin;
+                pe->path.writePointsPath(mapped + 2 * relative);
+                glFlushMappedBufferRange(GL_ARRAY_BUFFER, static_cast<GLintptr>(relative * vertex_size),
+                                         static_cast<GLsizeiptr>(allocation.count * vertex_size));
+            }
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        } else {
+            // Mapping may fail on some drivers, upload every path separately then
+            std::vector<GLfloat> vertices;
+            for (const auto& fresh_path: fresh) {
+                const auto* pe = fresh_path.first;
+                const auto& allocation = allocations.at(pe->id);
+                vertices.resize(2 * allocation.count);
+                pe->path.writePointsPath(vertices.data());
+                glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(allocation.offset * vertex_size),
+                                static_cast<GLsizeiptr>(allocation.count * vertex_size), vertices.data());
+            }
+        }
+        release();
+    }
+
+    ranges.clear();
+    ranges.reserve(paths.size());
+    for (const auto& pe: paths) {
+        const auto& allocation = allocations.at(pe.id);
+        ranges.push_back({static_cast<GLint>(allocation.offset), static_cast<GLsizei>(allocation.count)});
+    }
+    return ranges;
+}
+
+size_t PathBuffer::allocate(size_t count) {
+    if (count == 0) return prefix_count;
+    // First fit
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        if (it->second < count) continue;
+        const auto offset = it->first;
+        const auto rest = it->second - count;
+        free_ranges.erase(it);
+        if (rest) free_ranges.emplace(offset + count, rest);
+        return offset;
+    }
+    return no_offset;
+}
+
+void PathBuffer::free(const Allocation& allocation) {
+    if (allocation.count == 0) return;
+    auto offset = allocation.offset;
+    auto count = allocation.count;
+    auto next = free_ranges.lower_bound(offset);
+    if (next != free_ranges.begin()) {
+        const auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            count += prev->second;
+            free_ranges.erase(prev);
+        }
+    }
+    if (next != free_ranges.end() && offset + count == next->first) {
+        count += next->second;
+        free_ranges.erase(next);
+    }
+    free_ranges.emplace(offset, count);
+}
+
+void PathBuffer::reserve(size_t count) {
+    if (count <= capacity) return;
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(count * vertex_size), nullptr, GL_DYNAMIC_DRAW);
+    if (capacity) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            static_cast<GLsizeiptr>(capacity * vertex_size));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = grown;
+    capacity = count;
+}
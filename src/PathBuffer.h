@@ -0,0 +1,69 @@
+#ifndef USV_GUI_PATHBUFFER_H
+#define USV_GUI_PATHBUFFER_H
+
+#include "Buffer.h"
+#include "usvdata/CaseData.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Vertex buffer of path polylines (x, y floats) with a stable sub-allocation per PathEnvelope.
+ * Paths kept between updates (same PathEnvelope::id) keep their range and are not uploaded again,
+ * new paths are written straight into a mapped range, ranges of removed paths are reused.
+ */
+class PathBuffer {
+public:
+    struct Range {
+        GLint first;
+        GLsizei count;
+    };
+
+    /**
+     * @param prefix Vertices kept at the start of buffer, e.g. marker shapes
+     */
+    explicit PathBuffer(std::vector<GLfloat> prefix = {});
+
+    ~PathBuffer();
+
+    PathBuffer(const PathBuffer&) = delete;
+
+    PathBuffer& operator=(const PathBuffer&) = delete;
+
+    /**
+     * Makes buffer contain given paths and no others
+     * @return Vertex ranges of paths, in the same order
+     */
+    const std::vector<Range>& update(const std::vector<USV::PathEnvelope>& paths);
+
+    void bind() const;
+
+    static void release();
+
+    //! Vertex range of prefix
+    [[nodiscard]] inline Range prefix() const { return {0, static_cast<GLsizei>(prefix_count)}; }
+
+private:
+    struct Allocation {
+        size_t offset;
+        size_t count;
+    };
+
+    GLuint buffer{};
+    size_t capacity{0}; //! Vertices
+    size_t prefix_count{0};
+    std::unordered_map<uint64_t, Allocation> allocations;
+    std::map<size_t, size_t> free_ranges; //! Offset -> count, adjacent ranges merged
+    std::vector<Range> ranges;
+
+    //! First fit in free ranges, no_offset if none is large enough. Buffer is never grown here.
+    size_t allocate(size_t count);
+
+    void free(const Allocation& allocation);
+
+    //! Grows buffer to at least count vertices, copying contents on GPU
+    void reserve(size_t count);
+};
+
+#endif //USV_GUI_PATHBUFFER_H
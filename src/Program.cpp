@@ -1,8 +1,15 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 #include "Program.h"
+#include "usvdata/CacheDirectory.h"
+#include "usvdata/Hash.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 
 void printShaderLog(GLuint shader) {
     GLint i;
@@ -31,25 +38,142 @@ int checkProgram(GLuint p) {
     return linked;
 }
 
+namespace {
+    namespace fs = std::filesystem;
+
+    // Bump when key or file layout changes
+    constexpr uint32_t binary_cache_version = 1;
+    constexpr char binary_magic[4] = {'U', 'S', 'V', 'P'};
+
+    // Cache directory, empty if caching is disabled or program binaries aren't supported
+    const fs::path& binary_cache_directory() {
+        static const fs::path directory = []() -> fs::path {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+#if defined(NANOGUI_GLAD)
+            if (!glProgramBinary || !glGetProgramBinary || !glProgramParameteri) return {};
+#endif
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            // Clear GL_INVALID_ENUM of drivers without the extension
+            while (glGetError() != GL_NO_ERROR) {}
+            if (formats <= 0) return {};
+            return USV::cacheDirectory("USV_GUI_SHADER_CACHE", "shaders");
+#else
+            return {};
+#endif
+        }();
+        return directory;
+    }
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    std::string gl_string(GLenum name) {
+        const auto* s = reinterpret_cast<const char*>(glGetString(name));
+        return s ? s : "";
+    }
+
+    // Binary is only valid for the driver that produced it
+    fs::path binary_cache_file(const std::vector<std::pair<GLenum, std::string>>& sources) {
+        uint64_t key = USV::fnv1a(&binary_cache_version, sizeof(binary_cache_version));
+        for (const auto name: {GL_VENDOR, GL_RENDERER, GL_VERSION})
+            key = USV::fnv1a(gl_string(name), key);
+        for (const auto& [type, source]: sources) {
+            key = USV::fnv1a(&type, sizeof(type), key);
+            key = USV::fnv1a(source, key);
+        }
+        char name[21];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return binary_cache_directory() / name;
+    }
+
+    // File: magic, binary format, binary
+    bool load_binary(GLuint program, const fs::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) return false;
+        char magic[sizeof(binary_magic)];
+        GLenum format;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, binary_magic, sizeof(magic)) != 0 ||
+            !in.read(reinterpret_cast<char*>(&format), sizeof(format)))
+            return false;
+        const std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (binary.empty()) return false;
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        // Rejected binary (driver update) leaves GL_INVALID_ENUM or GL_INVALID_VALUE behind
+        while (glGetError() != GL_NO_ERROR) {}
+        return linked != 0;
+    }
+
+    void save_binary(GLuint program, const fs::path& file) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<char> binary(static_cast<size_t>(length));
+        GLenum format = 0;
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+        if (glGetError() != GL_NO_ERROR || length <= 0) return;
+
+        // Written aside and renamed, so other instances never read or overwrite a partial file
+        std::error_code ec;
+        fs::create_directories(file.parent_path(), ec);
+        const auto tmp = USV::temporaryPath(file);
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(binary_magic, sizeof(binary_magic));
+            out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            out.write(binary.data(), length);
+            if (!out) {
+                out.close();
+                fs::remove(tmp, ec);
+                return;
+            }
+        }
+        fs::rename(tmp, file, ec);
+        if (ec) fs::remove(tmp, ec);
+    }
+#endif
+}
+
 void Program::addVertexShader(const char* source) {
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glAttachShader(program, vertexShader);
-    glShaderSource(vertexShader, 1, &source, nullptr);
-    glCompileShader(vertexShader);
-    checkShader(vertexShader, source);
-    assert(glGetError() == 0);
+    sources.emplace_back(GL_VERTEX_SHADER, source);
 }
 
 void Program::addFragmentShader(const char* source) {
-    fragmentShaders.push_back(glCreateShader(GL_FRAGMENT_SHADER));
-    glShaderSource(fragmentShaders.back(), 1, &source, nullptr);
-    glCompileShader(fragmentShaders.back());
-    checkShader(fragmentShaders.back(), source);
-    glAttachShader(program, fragmentShaders.back());
-    assert(glGetError() == 0);
+    sources.emplace_back(GL_FRAGMENT_SHADER, source);
 }
 
 void Program::link() {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    if (!binary_cache_directory().empty()) {
+        const auto file = binary_cache_file(sources);
+        if (load_binary(program, file)) {
+            reflect();
+            return;
+        }
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        compileAndLink();
+        save_binary(program, file);
+        return;
+    }
+#endif
+    compileAndLink();
+}
+
+void Program::compileAndLink() {
+    for (const auto& [type, source]: sources) {
+        const GLuint shader = glCreateShader(type);
+        const char* text = source.c_str();
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        checkShader(shader, text);
+        glAttachShader(program, shader);
+        if (type == GL_VERTEX_SHADER)
+            vertexShader = static_cast<int>(shader);
+        else
+            fragmentShaders.push_back(static_cast<GLint>(shader));
+        assert(glGetError() == 0);
+    }
+
     glLinkProgram(program);
     GLint logLength;
     glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
@@ -61,6 +185,7 @@ void Program::link() {
 
     if (checkProgram(program)) {
         assert(glGetError() == 0);
+        reflect();
     } else {
         printShaderLog(vertexShader);
         for (auto fragmentShader: fragmentShaders)
@@ -69,8 +194,145 @@ void Program::link() {
     }
 }
 
-GLint Program::uniformLocation(const char* uniform) const {
-    return glGetUniformLocation(program, uniform);
+namespace {
+    // 32-bit words of uniform value of type
+    size_t type_words(GLenum type) {
+        switch (type) {
+            case GL_FLOAT_VEC2:
+            case GL_INT_VEC2:
+            case GL_UNSIGNED_INT_VEC2:
+            case GL_BOOL_VEC2:
+                return 2;
+            case GL_FLOAT_VEC3:
+            case GL_INT_VEC3:
+            case GL_UNSIGNED_INT_VEC3:
+            case GL_BOOL_VEC3:
+                return 3;
+            case GL_FLOAT_VEC4:
+            case GL_INT_VEC4:
+            case GL_UNSIGNED_INT_VEC4:
+            case GL_BOOL_VEC4:
+            case GL_FLOAT_MAT2:
+                return 4;
+            case GL_FLOAT_MAT2x3:
+            case GL_FLOAT_MAT3x2:
+                return 6;
+            case GL_FLOAT_MAT2x4:
+            case GL_FLOAT_MAT4x2:
+                return 8;
+            case GL_FLOAT_MAT3:
+                return 9;
+            case GL_FLOAT_MAT3x4:
+            case GL_FLOAT_MAT4x3:
+                return 12;
+            case GL_FLOAT_MAT4:
+                return 16;
+            default:
+                // Scalars, samplers
+                return 1;
+        }
+    }
+
+    template<typename Callback>
+    void for_each_active(GLuint program, GLenum count_name, GLenum length_name, Callback&& callback) {
+        GLint count = 0, max_length = 0;
+        glGetProgramiv(program, count_name, &count);
+        glGetProgramiv(program, length_name, &max_length);
+        std::vector<GLchar> name(static_cast<size_t>(std::max(max_length, 1)));
+        for (GLuint i = 0; i < static_cast<GLuint>(count); ++i)
+            callback(i, name);
+    }
+}
+
+void Program::reflect() {
+    uniforms.clear();
+    uniform_blocks.clear();
+    attributes.clear();
+    const auto id = static_cast<GLuint>(program);
+
+    for_each_active(id, GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH, [&](GLuint i, std::vector<GLchar>& name) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+        std::string uniform_name(name.data(), static_cast<size_t>(length));
+        // Members of uniform blocks have no location
+        const auto location = glGetUniformLocation(id, uniform_name.c_str());
+        if (location < 0) return;
+        if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0)
+            uniform_name.resize(uniform_name.size() - 3);
+        uniforms[uniform_name] = {location, type, size};
+    });
+
+    for_each_active(id, GL_ACTIVE_UNIFORM_BLOCKS, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                    [&](GLuint i, std::vector<GLchar>& name) {
+                        GLsizei length = 0;
+                        glGetActiveUniformBlockName(id, i, static_cast<GLsizei>(name.size()), &length, name.data());
+                        uniform_blocks[std::string(name.data(), static_cast<size_t>(length))] = i;
+                    });
+
+    for_each_active(id, GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, [&](GLuint i, std::vector<GLchar>& name) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(id, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+        std::string attribute_name(name.data(), static_cast<size_t>(length));
+        attributes[attribute_name] = {glGetAttribLocation(id, attribute_name.c_str()), type};
+    });
+
+    // Shadow slot of array covers all of its elements, arrays are written through their first location
+    shadows.clear();
+    shadow_values.clear();
+    for (const auto& entry: uniforms) {
+        const auto& u = entry.second;
+        if (static_cast<size_t>(u.location) >= shadows.size()) shadows.resize(static_cast<size_t>(u.location) + 1);
+        auto& shadow = shadows[static_cast<size_t>(u.location)];
+        shadow.offset = shadow_values.size();
+        shadow.words = type_words(u.type) * static_cast<size_t>(u.size);
+        shadow.type = u.type;
+        shadow_values.resize(shadow_values.size() + shadow.words);
+    }
+}
+
+bool Program::changed(GLint location, GLenum type, const void* value, size_t words) const {
+    if (location < 0) return false;
+    if (static_cast<size_t>(location) >= shadows.size() || shadows[static_cast<size_t>(location)].words == 0)
+        return true;
+    auto& shadow = shadows[static_cast<size_t>(location)];
+    assert((type == 0 ? shadow.type != GL_FLOAT : shadow.type == type) && "Uniform set with value of wrong type");
+    (void) type;
+    if (words > shadow.words) return true;
+    auto* stored = shadow_values.data() + shadow.offset;
+    if (shadow.valid && std::memcmp(stored, value, words * sizeof(uint32_t)) == 0) return false;
+    std::memcpy(stored, value, words * sizeof(uint32_t));
+    // Shorter array writes leave the rest of elements unknown
+    shadow.valid = words == shadow.words;
+    return true;
+}
+
+GLint Program::uniformLocation(const std::string& name) const {
+    const auto* u = uniform(name);
+    return u ? u->location : -1;
+}
+
+const Program::Uniform* Program::uniform(const std::string& name) const {
+    const auto it = uniforms.find(name);
+    return it == uniforms.end() ? nullptr : &it->second;
+}
+
+GLuint Program::uniformBlockIndex(const std::string& block) const {
+    const auto it = uniform_blocks.find(block);
+    return it == uniform_blocks.end() ? GL_INVALID_INDEX : it->second;
+}
+
+void Program::bindUniformBlock(const std::string& block, GLuint binding) const {
+    const auto index = uniformBlockIndex(block);
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(static_cast<GLuint>(program), index, binding);
+}
+
+GLint Program::attributeLocation(const std::string& name) const {
+    const auto it = attributes.find(name);
+    return it == attributes.end() ? -1 : it->second.location;
 }
 
 void Program::bind() const {
@@ -82,30 +344,47 @@ void Program::release() {
 }
 
 void Program::setUniformValue(GLint location, const glm::vec3& v) const {
+    if (!changed(location, GL_FLOAT_VEC3, &v, 3)) return;
     glUseProgram(program);
     glUniform3fv(location, 1, reinterpret_cast<const GLfloat*>(&v));
 }
 
 void Program::setUniformValue(GLint location, const glm::vec4& v) const {
+    if (!changed(location, GL_FLOAT_VEC4, &v, 4)) return;
     glUseProgram(program);
     glUniform4fv(location, 1, reinterpret_cast<const GLfloat*>(&v));
 }
 
 void Program::setUniformValue(GLint location, const glm::mat3& v) const {
+    if (!changed(location, GL_FLOAT_MAT3, &v, 9)) return;
     glUseProgram(program);
     glUniformMatrix3fv(location, 1, GL_FALSE, reinterpret_cast<const GLfloat*>(&v));
 }
 
 void Program::setUniformValue(GLint location, const glm::mat4& v) const {
+    if (!changed(location, GL_FLOAT_MAT4, &v, 16)) return;
     glUseProgram(program);
     glUniformMatrix4fv(location, 1, GL_FALSE, reinterpret_cast<const GLfloat*>(&v));
 }
 
 void Program::setUniformValue(GLint location, const GLfloat& v) const {
+    if (!changed(location, GL_FLOAT, &v, 1)) return;
     glUseProgram(program);
     glUniform1f(location, v);
 }
 
+void Program::setUniformInt(GLint location, GLint v) const {
+    if (!changed(location, 0, &v, 1)) return;
+    glUseProgram(program);
+    glUniform1i(location, v);
+}
+
+void Program::setUniformArray(GLint location, const glm::vec3* v, GLsizei count) const {
+    if (!changed(location, GL_FLOAT_VEC3, v, 3 * static_cast<size_t>(count))) return;
+    glUseProgram(program);
+    glUniform3fv(location, count, reinterpret_cast<const GLfloat*>(v));
+}
+
 Program::Program() : vertexShader(-1) {
     program = glCreateProgram();
     assert(glGetError() == 0);
@@ -123,17 +402,17 @@ Program::~Program() {
 }
 
 Program& Program::operator=(Program&& other) noexcept {
-    glDeleteProgram(program);
-    if (vertexShader != -1) {
-        glDeleteShader(vertexShader);
-    }
-    for (auto fragmentShader:fragmentShaders)
-        if (fragmentShader != -1) {
-            glDeleteShader(fragmentShader);
-        }
+    // Previous program and shaders are released by other
     std::swap(program, other.program);
     std::swap(vertexShader, other.vertexShader);
     std::swap(fragmentShaders, other.fragmentShaders);
+    std::swap(sources, other.sources);
+    // Reflection and written values belong to the program they were taken from
+    std::swap(uniforms, other.uniforms);
+    std::swap(uniform_blocks, other.uniform_blocks);
+    std::swap(attributes, other.attributes);
+    std::swap(shadows, other.shadows);
+    std::swap(shadow_values, other.shadow_values);
     return *this;
 }
 
@@ -8,14 +8,58 @@
 #include <GL/glext.h>
 #endif
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class Program {
+public:
+    //! Active uniform, arrays are listed under their name without "[0]"
+    struct Uniform {
+        GLint location;
+        GLenum type;
+        GLint size; //! Array elements, 1 for non-arrays
+    };
+
+    struct Attribute {
+        GLint location;
+        GLenum type;
+    };
+
+private:
     int program;
     int vertexShader;
 
     std::vector<GLint> fragmentShaders;
 
+    //! Shader type and source, compiled in link() unless program binary is found in cache
+    std::vector<std::pair<GLenum, std::string>> sources;
+
+    std::unordered_map<std::string, Uniform> uniforms;
+    std::unordered_map<std::string, GLuint> uniform_blocks;
+    std::unordered_map<std::string, Attribute> attributes;
+
+    //! Last value written to each uniform location, so unchanged values aren't written again
+    struct Shadow {
+        size_t offset{0}; //! Into shadow_values
+        size_t words{0}; //! 0 if location isn't a known uniform
+        GLenum type{0};
+        bool valid{false};
+    };
+    mutable std::vector<Shadow> shadows;
+    mutable std::vector<uint32_t> shadow_values;
+
+    //! Compile sources, attach and link, exits if any of them fails
+    void compileAndLink();
+
+    //! Collect active uniforms, uniform blocks and attributes of linked program
+    void reflect();
+
+    //! Whether value differs from the last one written to location, remembers it if so
+    bool changed(GLint location, GLenum type, const void* value, size_t words) const;
+
 public:
 
     Program();
@@ -32,13 +76,31 @@ public:
 
     void addFragmentShader(const char* source);
 
+    /**
+     * Links program from added shaders. Program binary of the same sources and driver is loaded
+     * from on-disk cache (USV_GUI_SHADER_CACHE, default usv-gui/shaders in user cache directory)
+     * if there is one the driver accepts, otherwise shaders are compiled and the result is cached.
+     */
     void link();
 
     void bind() const;
 
     static void release();
 
-    GLint uniformLocation(const char* uniform) const;
+    //! Location of active uniform, -1 if there is none with such name
+    [[nodiscard]] GLint uniformLocation(const std::string& uniform) const;
+
+    //! Active uniform with such name, nullptr if there is none
+    [[nodiscard]] const Uniform* uniform(const std::string& name) const;
+
+    //! Index of active uniform block, GL_INVALID_INDEX if there is none with such name
+    [[nodiscard]] GLuint uniformBlockIndex(const std::string& block) const;
+
+    //! Binds uniform block to binding point if program uses it
+    void bindUniformBlock(const std::string& block, GLuint binding) const;
+
+    //! Location of active attribute, -1 if there is none with such name
+    [[nodiscard]] GLint attributeLocation(const std::string& attribute) const;
 
     [[nodiscard]] inline GLint programId() const { return program; }
 
@@ -52,6 +114,12 @@ public:
 
     void setUniformValue(GLint location, const glm::mat4& mat4) const;
 
+    // Not an overload of setUniformValue, int literals passed for float uniforms must stay floats.
+    // Also sets bool and sampler uniforms.
+    void setUniformInt(GLint location, GLint i) const;
+
+    void setUniformArray(GLint location, const glm::vec3* vec3, GLsizei count) const;
+
     ~Program();
 };
 
@@ -0,0 +1,78 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+
+namespace {
+    // Regions are reallocated with some headroom, so slowly growing data doesn't orphan every write
+    constexpr size_t min_region_size = 4096;
+    constexpr GLuint64 fence_timeout = 1000000000; // 1 sec in nanoseconds
+}
+
+StreamBuffer::StreamBuffer() {
+    glGenBuffers(1, &buffer);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (auto& f: fences)
+        if (f) glDeleteSync(f);
+    glDeleteBuffers(1, &buffer);
+}
+
+void StreamBuffer::bind() const {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void StreamBuffer::release() {
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamBuffer::wait(size_t index) {
+    auto& f = fences[index];
+    if (!f) return;
+    while (glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, fence_timeout) == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(f);
+    f = nullptr;
+}
+
+void* StreamBuffer::map(size_t size) {
+    bind();
+    written = size;
+    if (size > region_size) {
+        // Orphan old storage, draws still reading it keep it alive
+        region_size = std::max({size + size / 2, region_size * 2, min_region_size});
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(region_size * regions_count), nullptr, GL_STREAM_DRAW);
+        for (auto& f: fences)
+            if (f) glDeleteSync(f);
+        fences = {};
+        region = 0;
+    } else {
+        region = (region + 1) % regions_count;
+        wait(region);
+    }
+
+    void* data = size == 0 ? nullptr : glMapBufferRange(
+            GL_ARRAY_BUFFER, static_cast<GLintptr>(region * region_size), static_cast<GLsizeiptr>(size),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    mapped = data != nullptr;
+    if (mapped) return data;
+    staging.resize(std::max<size_t>(size, 1));
+    return staging.data();
+}
+
+GLintptr StreamBuffer::unmap() {
+    const auto offset = static_cast<GLintptr>(region * region_size);
+    bind();
+    // GL_FALSE from unmap means contents were lost, e.g. on display mode change, next write replaces them
+    if (mapped)
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    else if (written)
+        glBufferSubData(GL_ARRAY_BUFFER, offset, static_cast<GLsizeiptr>(written), staging.data());
+    mapped = false;
+    return offset;
+}
+
+void StreamBuffer::fence() {
+    auto& f = fences[region];
+    if (f) glDeleteSync(f);
+    f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
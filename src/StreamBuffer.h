@@ -0,0 +1,65 @@
+#ifndef USV_GUI_STREAMBUFFER_H
+#define USV_GUI_STREAMBUFFER_H
+
+#include "Buffer.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Vertex buffer for data rewritten between frames. Storage is split into regions written in turn,
+ * each guarded by a fence placed after draws reading it, so a write only waits for the GPU when it
+ * is regions_count updates ahead. Data is written in place through an unsynchronized mapping,
+ * storage grows by orphaning.
+ */
+class StreamBuffer {
+public:
+    static constexpr size_t regions_count = 3;
+
+    StreamBuffer();
+
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /**
+     * Maps next region for writing
+     * @param size Bytes to write
+     * @return Pointer to write exactly size bytes to, valid until unmap()
+     */
+    void* map(size_t size);
+
+    /**
+     * Finishes write started by map(), buffer stays bound
+     * @return Byte offset of written data in buffer
+     */
+    GLintptr unmap();
+
+    /**
+     * Places fence after draws issued so far, they read the last written region
+     */
+    void fence();
+
+    void bind() const;
+
+    static void release();
+
+    [[nodiscard]] inline GLuint bufferId() const { return buffer; }
+
+private:
+    GLuint buffer{};
+    size_t region_size{0}; //! Bytes
+    size_t region{0}; //! Last written region
+    size_t written{0}; //! Bytes of current write
+    bool mapped{false};
+    std::vector<char> staging; //! Written instead if mapping fails
+    std::array<GLsync, regions_count> fences{};
+
+    //! Waits for fence of region and deletes it
+    void wait(size_t index);
+};
+
+#endif //USV_GUI_STREAMBUFFER_H
@@ -67,8 +67,7 @@ GLGrid::GLGrid() {
     m_program->addFragmentShader(fragmentShaderSource);
     m_program->link();
     m_program->bind();
-    auto ul_matrices = glGetUniformBlockIndex(m_program->programId(), "Matrices");
-    glUniformBlockBinding(m_program->programId(), ul_matrices, USV_GUI_MATRICES_BINDING);
+    m_program->bindUniformBlock("Matrices", USV_GUI_MATRICES_BINDING);
     m_colorLoc = m_program->uniformLocation("color");
     m_program->setUniformValue(m_colorLoc, glm::vec4(135, 135, 135, 255)/ 255.0f);
     m_program->setUniformValue(m_program->uniformLocation("bg_color"), glm::vec4(135, 135, 135, 0) / 255.0f);
@@ -1,8 +1,8 @@
 #include "glrestrictions.h"
-#include "earcut.h"
 #include "utils.h"
 #include "glgrid.h"
 #include <array>
+#include <cstddef>
 #include <cmrc/cmrc.hpp>
 #include "Defines.h"
 #include "Program.h"
@@ -10,35 +10,97 @@
 
 CMRC_DECLARE(glsl_resources);
 
+namespace {
+    // Material of each geometry class, restriction color gives ambient and diffuse
+    constexpr float isle_specular = 255.0f / 400.0f;
+    constexpr float contour_specular = 255.0f / 400.0f;
+}
+
 GLRestrictions::GLRestrictions() {
     m_program = std::make_unique<Program>();
     auto fs = cmrc::glsl_resources::get_filesystem();
-    m_program->addVertexShader(fs.open("glsl/general.vert").cbegin());
+    m_program->addVertexShader(fs.open("glsl/restrictions.vert").cbegin());
     m_program->addFragmentShader(GLGrid::xyGridShaderSource);
     m_program->addFragmentShader(fs.open("glsl/restrictions.frag").cbegin());
     m_program->link();
     m_program->bind();
 
-    auto ul_matrices = glGetUniformBlockIndex(m_program->programId(), "Matrices");
-    glUniformBlockBinding(m_program->programId(), ul_matrices, USV_GUI_MATRICES_BINDING);
-
-    auto ul_light = glGetUniformBlockIndex(m_program->programId(), "Light");
-    glUniformBlockBinding(m_program->programId(), ul_light, USV_GUI_LIGHTS_BINDING);
+    m_program->bindUniformBlock("Matrices", USV_GUI_MATRICES_BINDING);
+    m_program->bindUniformBlock("Light", USV_GUI_LIGHTS_BINDING);
 
     m_viewLoc = m_program->uniformLocation("viewPos");
-
-    const struct {
-        glm::vec3 ambient = glm::vec3(255, 0, 0) / 255.0f;
-        glm::vec3 diffuse = glm::vec3(255, 200, 0) / 255.0f;
-        glm::vec3 specular = glm::vec3(255, 204, 51) / 400.0f;
-        float shininess{1};
-    } material;
-    m_program->setUniformValue(m_program->uniformLocation("material.ambient"), material.ambient);
-    m_program->setUniformValue(m_program->uniformLocation("material.diffuse"), material.diffuse);
-    m_program->setUniformValue(m_program->uniformLocation("material.specular"), material.specular);
-    m_program->setUniformValue(m_program->uniformLocation("material.shininess"), material.shininess);
-    m_program->setUniformValue(m_program->uniformLocation("opacity"), 1.0f);
+    m_ambientScaleLoc = m_program->uniformLocation("ambient_scale");
+    m_diffuseScaleLoc = m_program->uniformLocation("diffuse_scale");
+    m_specularLoc = m_program->uniformLocation("specular_color");
+    m_shininessLoc = m_program->uniformLocation("shininess");
     m_program->release();
+
+    isles = std::make_unique<Batch>(Material{0.5f, 1.0f, glm::vec3(isle_specular), 1.0f});
+    polygons = std::make_unique<Batch>(Material{1.0f, 0.8f, glm::vec3(0.0f), 16.0f});
+    contours = std::make_unique<Batch>(Material{1.0f, 0.8f, glm::vec3(contour_specular), 16.0f});
+}
+
+GLRestrictions::~GLRestrictions() = default;
+
+GLRestrictions::Batch::Batch(const Material& material) : vbo(std::make_unique<Buffer>()),
+                                                         ibo(std::make_unique<Buffer>()), material(material) {
+    vbo->create();
+    ibo->create();
+    glGenVertexArrays(1, &vao);
+    GLint previous_vao{0};
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glBindVertexArray(vao);
+    vbo->bind();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->bufferId());
+    // layout(location = 0) in vec4 vertex;
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, position));
+    // layout(location = 1) in vec3 normal;
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, normal));
+    // layout(location = 2) in vec3 color;
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, color));
+    // layout(location = 3) in float opacity;
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, opacity));
+    // layout(location = 4) in uint id;
+    glEnableVertexAttribArray(4);
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*) offsetof(Vertex, id));
+    glBindVertexArray(static_cast<GLuint>(previous_vao));
+    vbo->release();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+GLRestrictions::Batch::~Batch() {
+    glDeleteVertexArrays(1, &vao);
+}
+
+void GLRestrictions::Batch::clear() {
+    vertices.clear();
+    indices.clear();
+    loops_first.clear();
+    loops_count.clear();
+    indices_count = 0;
+}
+
+void GLRestrictions::Batch::upload() {
+    indices_count = static_cast<GLsizei>(indices.size());
+    vbo->bind();
+    vbo->allocate(vertices.data(), static_cast<GLsizeiptr>(data_sizeof(vertices)));
+    vbo->release();
+    ibo->bind();
+    ibo->allocate(indices.data(), static_cast<GLsizeiptr>(data_sizeof(indices)));
+    ibo->release();
+    vertices = {};
+    indices = {};
+}
+
+void GLRestrictions::setMaterial(const Material& material) const {
+    m_program->setUniformValue(m_ambientScaleLoc, material.ambient_scale);
+    m_program->setUniformValue(m_diffuseScaleLoc, material.diffuse_scale);
+    m_program->setUniformValue(m_specularLoc, material.specular);
+    m_program->setUniformValue(m_shininessLoc, material.shininess);
 }
 
 void GLRestrictions::render(glm::vec3 eyePos, GeometryType gtype) {
@@ -46,165 +108,94 @@ void GLRestrictions::render(glm::vec3 eyePos, GeometryType gtype) {
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     m_program->bind();
     m_program->setUniformValue(m_viewLoc, eyePos);
+    GLint previous_vao{0};
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
     glDepthMask(GL_TRUE);
-    if (gtype & GeometryTypes::Isle)
-        for (auto& poly:glisles) {
-            poly.render(*m_program);
-        }
+    if (gtype & GeometryTypes::Isle && isles->indices_count > 0) {
+        setMaterial(isles->material);
+        glBindVertexArray(isles->vao);
+        glDrawElements(GL_TRIANGLES, isles->indices_count, GL_UNSIGNED_INT, nullptr);
+    }
     glDepthMask(GL_FALSE);
-    if (gtype & GeometryTypes::Polygon)
-        for (auto& poly:glpolygons) {
-            poly.render(*m_program);
-        }
+    if (gtype & GeometryTypes::Polygon && polygons->indices_count > 0) {
+        setMaterial(polygons->material);
+        glBindVertexArray(polygons->vao);
+        glDrawElements(GL_TRIANGLES, polygons->indices_count, GL_UNSIGNED_INT, nullptr);
+    }
     glDepthMask(GL_TRUE);
-    if (gtype & GeometryTypes::Contour)
-        for (auto& poly:glcontours) {
-            poly.render(*m_program);
-        }
+    if (gtype & GeometryTypes::Contour && !contours->loops_first.empty()) {
+        setMaterial(contours->material);
+        glBindVertexArray(contours->vao);
+        glMultiDrawArrays(GL_LINE_LOOP, contours->loops_first.data(), contours->loops_count.data(),
+                          static_cast<GLsizei>(contours->loops_first.size()));
+    }
+    glBindVertexArray(static_cast<GLuint>(previous_vao));
     m_program->release();
     glDisable(GL_BLEND);
     glDepthMask(GL_TRUE);
 }
 
 void GLRestrictions::load_restrictions(const USV::Restrictions::Restrictions& restrictions) {
-    glpolygons.clear();
-    glcontours.clear();
-    glisles.clear();
+    meta_.clear();
+    isles->clear();
+    polygons->clear();
+    contours->clear();
     glm::vec3 c_hard{1.0f, 0.0f, 0.0f};
     glm::vec3 c_soft{1.0f, 0.8f, 0.0f};
     for (auto& limitation:restrictions.hard.ZoneEnteringProhibitions()) {
         meta_.push_back({limitation._ptr});
         if (limitation._ptr->source_object_code == "LNDARE") {
-            glisles.emplace_back(limitation.polygon, c_hard, meta_.size() - 1);
+            addIsle(*isles, limitation.polygon, c_hard, meta_.size() - 1);
         }
-        else { glpolygons.emplace_back(limitation.polygon, c_hard, meta_.size() - 1, 0.5f);
-        glcontours.emplace_back(limitation.polygon, c_soft, meta_.size() - 1);}
+        else { addPolygon(*polygons, limitation.polygon, c_hard, meta_.size() - 1, 0.5f);
+        addContour(*contours, limitation.polygon, c_soft, meta_.size() - 1);}
     }
 
     for (auto& limitation:restrictions.soft.ZoneEnteringProhibitions()) {
         meta_.push_back({limitation._ptr});
         if (limitation._ptr->source_object_code == "LNDARE")
-            glisles.emplace_back(limitation.polygon, c_soft, meta_.size() - 1);
-        else { glcontours.emplace_back(limitation.polygon, c_soft, meta_.size() - 1); glcontours.emplace_back(limitation.polygon, c_soft, meta_.size() - 1); }
+            addIsle(*isles, limitation.polygon, c_soft, meta_.size() - 1);
+        else addContour(*contours, limitation.polygon, c_soft, meta_.size() - 1);
     }
     glm::vec3 c_movement{0.5f, 0.5f, 0.5f};
     for (auto& limitation:restrictions.soft.MovementParametersLimitations()) {
         meta_.push_back({limitation._ptr});
-        glpolygons.emplace_back(limitation.polygon, c_movement, meta_.size() - 1);
-        glcontours.emplace_back(limitation.polygon, c_soft, meta_.size() - 1);
+        addPolygon(*polygons, limitation.polygon, c_movement, meta_.size() - 1);
+        addContour(*contours, limitation.polygon, c_soft, meta_.size() - 1);
     }
     for (auto& limitation:restrictions.hard.MovementParametersLimitations()) {
         meta_.push_back({limitation._ptr});
-        glpolygons.emplace_back(limitation.polygon, c_movement, meta_.size() - 1);
-        glcontours.emplace_back(limitation.polygon, c_soft, meta_.size() - 1);
+        addPolygon(*polygons, limitation.polygon, c_movement, meta_.size() - 1);
+        addContour(*contours, limitation.polygon, c_soft, meta_.size() - 1);
     }
+    isles->upload();
+    polygons->upload();
+    contours->upload();
 }
 
-void GLRestrictions::Polygon::render(const Program& program) {
-    program.bind();
-    program.setUniformValue(program.uniformLocation("material.ambient"), color);
-    program.setUniformValue(program.uniformLocation("material.diffuse"), color * 0.8f);
-    program.setUniformValue(program.uniformLocation("material.specular"), glm::vec3(0, 0, 0) / 400.0f);
-    program.setUniformValue(program.uniformLocation("material.shininess"), 16.0f);
-    program.setUniformValue(program.uniformLocation("opacity"), opacity);
-    glUniform1i(program.uniformLocation("_id"), (GLint) id_);
-    vbo->bind();
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->bufferId());
-    int vertexLocation = glGetAttribLocation(program.programId(), "vertex");
-    glEnableVertexAttribArray(vertexLocation);
-    int normalLocation = glGetAttribLocation(program.programId(), "normal");
-    glDisableVertexAttribArray(normalLocation);
-    glVertexAttrib3f(normalLocation, 0.0, 0.0, 1.0);
-    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glDrawElements(GL_TRIANGLES, indices_count, GL_UNSIGNED_INT, nullptr);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    vbo->release();
-    glDisableVertexAttribArray(vertexLocation);
-    program.setUniformValue(program.uniformLocation("opacity"), 1.0f);
-    glUseProgram(0);
-}
-
-namespace mapbox::util {
-
-    template<>
-    struct nth<0, USV::Vector2> {
-        inline static auto get(const USV::Vector2& t) {
-            return t.x();
-        };
-    };
-
-    template<>
-    struct nth<1, USV::Vector2> {
-        inline static auto get(const USV::Vector2& t) {
-            return t.y();
-        };
-    };
-
-} // namespace mapbox
-
-GLRestrictions::Polygon::Polygon(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id,
-                                 float opacity)
-        : color(color), opacity(opacity), id_(id) {
-    // Run tessellation
-    // Returns array of indices that refer to the vertices of the input polygon.
+void GLRestrictions::addPolygon(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color,
+                                size_t id, float opacity) {
+    // Tessellation is done on loading, polygons built otherwise are triangulated here.
+    // Indices refer to the vertices of the input polygon.
     // Three subsequent indices form a triangle. Output triangles are clockwise.
-    std::vector<Index> indices = mapbox::earcut<Index>(polygon.rings);
-    indices_count = static_cast<GLuint>(indices.size());
-    std::vector<Point> vertices;
+    const auto base = static_cast<Index>(batch.vertices.size());
+    const auto triangles = polygon.triangles.empty() ? USV::Restrictions::triangulate(polygon) : polygon.triangles;
+    for (auto index: triangles)
+        batch.indices.push_back(base + index);
     for (auto& ring:polygon.rings)
         for (auto& point:ring)
-            vertices.push_back({(GLfloat) point.x(), (GLfloat) point.y()});
-
-    vbo = std::make_unique<Buffer>();
-    ibo = std::make_unique<Buffer>();
-    vbo->create();
-    ibo->create();
-    vbo->bind();
-    vbo->allocate(vertices.data(), static_cast<int>(data_sizeof(vertices)));
-    vbo->release();
-    ibo->bind();
-    ibo->allocate(indices.data(), static_cast<int>(data_sizeof(indices)));
-    ibo->release();
+            batch.vertices.push_back({{(GLfloat) point.x(), (GLfloat) point.y(), 0}, {0, 0, 1},
+                                      {color.r, color.g, color.b}, opacity, static_cast<GLuint>(id)});
 }
 
-GLRestrictions::Polygon::~Polygon() = default;
-
-GLRestrictions::Polygon::Polygon(GLRestrictions::Polygon&& o) noexcept:
-        vbo(std::exchange(o.vbo, nullptr)), ibo(std::exchange(o.ibo, nullptr)), indices_count(o.indices_count)
-        , color(o.color), opacity(o.opacity), id_(o.id_) {}
-
-void GLRestrictions::Isle::render(const Program& program) {
-    program.bind();
-    program.setUniformValue(program.uniformLocation("material.ambient"), color * 0.5f);
-    program.setUniformValue(program.uniformLocation("material.diffuse"), color);
-    program.setUniformValue(program.uniformLocation("material.specular"), glm::vec3(255, 255, 255) / 400.0f);
-    program.setUniformValue(program.uniformLocation("material.shininess"), 1);
-    vbo->bind();
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo->bufferId());
-    int vertexLocation = glGetAttribLocation(program.programId(), "vertex");
-    int normLocation = glGetAttribLocation(program.programId(), "normal");
-    glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*) nullptr);
-
-    glEnableVertexAttribArray(vertexLocation);
-    glVertexAttribPointer(normLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*) (3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(normLocation);
-
-    glDrawElements(GL_TRIANGLES, indices_count, GL_UNSIGNED_INT, nullptr);
-    glDisableVertexAttribArray(vertexLocation);
-    glDisableVertexAttribArray(normLocation);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    vbo->release();
-    glUseProgram(0);
-}
-
-GLRestrictions::Isle::Isle(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id) : color(color)
-        , id_(id) {
+void GLRestrictions::addIsle(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color,
+                             size_t id) {
     using Point6 = std::array<GLfloat, 6>;
     const auto z = 0.1f;
-    // Run tessellation
-    // Returns array of indices that refer to the vertices of the input polygon.
+    // Tessellation is done on loading, polygons built otherwise are triangulated here.
+    // Indices refer to the vertices of the input polygon.
     // Three subsequent indices form a triangle. Output triangles are clockwise.
-    std::vector<Index> indices = mapbox::earcut<Index>(polygon.rings);
+    std::vector<Index> indices = polygon.triangles.empty() ? USV::Restrictions::triangulate(polygon) : polygon.triangles;
 
     std::vector<Point6> vertices;
     for (auto& ring:polygon.rings)
@@ -259,67 +250,21 @@ GLRestrictions::Isle::Isle(const USV::Restrictions::Polygon& polygon, const glm:
         r = 0;
     }
 
-
-    indices_count = static_cast<GLuint>(indices.size());
-    vbo = std::make_unique<Buffer>();
-    ibo = std::make_unique<Buffer>();
-    vbo->create();
-    ibo->create();
-    vbo->bind();
-    vbo->allocate(vertices.data(), static_cast<int>(data_sizeof(vertices)));
-    vbo->release();
-    ibo->bind();
-    ibo->allocate(indices.data(), static_cast<int>(data_sizeof(indices)));
-    ibo->release();
-
+    const auto base = static_cast<Index>(batch.vertices.size());
+    for (auto index: indices)
+        batch.indices.push_back(base + index);
+    for (const auto& v: vertices)
+        batch.vertices.push_back({{v[0], v[1], v[2]}, {v[3], v[4], v[5]}, {color.r, color.g, color.b}, 1.0f,
+                                  static_cast<GLuint>(id)});
 }
 
-GLRestrictions::Isle::~Isle() = default;
-
-GLRestrictions::Isle::Isle(GLRestrictions::Isle&& o) noexcept:
-        vbo(std::exchange(o.vbo, nullptr)), ibo(std::exchange(o.ibo, nullptr)), indices_count(o.indices_count)
-        , color(o.color), id_(o.id_) {}
-
-
-GLRestrictions::Contour::Contour(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id) : color(
-        color), id_(id) {
-    std::vector<Point> vertices;
+void GLRestrictions::addContour(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color,
+                                size_t id) {
     for (auto& ring:polygon.rings) {
-        start_ptrs.push_back(static_cast<GLuint>(vertices.size()));
+        batch.loops_first.push_back(static_cast<GLint>(batch.vertices.size()));
+        batch.loops_count.push_back(static_cast<GLsizei>(ring.size()));
         for (auto& point:ring)
-            vertices.push_back({(GLfloat) point.x(), (GLfloat) point.y()});
+            batch.vertices.push_back({{(GLfloat) point.x(), (GLfloat) point.y(), 0}, {0, 0, 1},
+                                      {color.r, color.g, color.b}, 1.0f, static_cast<GLuint>(id)});
     }
-    start_ptrs.push_back(static_cast<GLuint>(vertices.size()));
-
-    vbo = std::make_unique<Buffer>();
-    vbo->create();
-    vbo->bind();
-    vbo->allocate(vertices.data(), static_cast<int>(data_sizeof(vertices)));
-    vbo->release();
-}
-
-void GLRestrictions::Contour::render(const Program& program) {
-    program.bind();
-    program.setUniformValue(program.uniformLocation("material.ambient"), color);
-    program.setUniformValue(program.uniformLocation("material.diffuse"), color * 0.8f);
-    program.setUniformValue(program.uniformLocation("material.specular"), glm::vec3(255, 255, 255) / 400.0f);
-    program.setUniformValue(program.uniformLocation("material.shininess"), 16);
-    vbo->bind();
-    int vertexLocation = glGetAttribLocation(program.programId(), "vertex");
-    glEnableVertexAttribArray(vertexLocation);
-    int normalLocation = glGetAttribLocation(program.programId(), "normal");
-    glVertexAttrib3f(normalLocation, 0.0, 0.0, 1.0);
-    glVertexAttribPointer(vertexLocation, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-    vbo->release();
-    for (size_t i = 0, j = 1; j < start_ptrs.size(); i = j++)
-        glDrawArrays(GL_LINE_LOOP, start_ptrs[i], start_ptrs[j] - start_ptrs[i]);
-
-    glDisableVertexAttribArray(vertexLocation);
-    glUseProgram(0);
 }
-
-GLRestrictions::Contour::Contour(GLRestrictions::Contour&& o) noexcept:
-        vbo(std::exchange(o.vbo, nullptr)), start_ptrs(std::move(o.start_ptrs)), color(o.color), id_(o.id_) {}
-
-GLRestrictions::Contour::~Contour() = default;
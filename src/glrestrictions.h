@@ -2,12 +2,12 @@
 #define USV_GUI_GLRESTRICTIONS_H
 
 #include "usvdata/Restrictions.h"
+#include "Buffer.h"
 #include <glm/glm.hpp>
 #include <utility>
 #include <memory>
 
 class Program;
-class Buffer;
 
 class GLRestrictions {
     struct RestrictionMeta {
@@ -17,6 +17,12 @@ class GLRestrictions {
 public:
     GLRestrictions();
 
+    ~GLRestrictions();
+
+    GLRestrictions(const GLRestrictions&) = delete;
+
+    GLRestrictions& operator=(const GLRestrictions&) = delete;
+
     void load_restrictions(const USV::Restrictions::Restrictions& restrictions);
 
     typedef unsigned int GeometryType;
@@ -30,62 +36,66 @@ public:
     void render(glm::vec3 eyePos, GeometryType gtype = GeometryTypes::All);
 
 private:
-    using Point = std::array<float, 2>;
     using Index = unsigned int;
 
-    class Polygon {
-        std::unique_ptr<Buffer> vbo;
-        std::unique_ptr<Buffer> ibo;
-        int indices_count;
-        glm::vec3 color;
-        float opacity;
-        size_t id_;
-    public:
-        Polygon(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id, float opacity = 1.0);
-
-        Polygon(Polygon&& o) noexcept;;
-
-        virtual ~Polygon();
+    struct Vertex {
+        GLfloat position[3];
+        GLfloat normal[3];
+        GLfloat color[3];
+        GLfloat opacity;
+        GLuint id; // Index in meta_
+    };
 
-        void render(const Program& m_program);
+    struct Material {
+        float ambient_scale;
+        float diffuse_scale;
+        glm::vec3 specular;
+        float shininess;
     };
 
-    class Isle {
+    /**
+     * All restrictions of one geometry class in one vertex buffer, with index buffer for
+     * triangles or line loop ranges for contours, drawn with a single (multi) draw call
+     */
+    struct Batch {
+        GLuint vao{};
         std::unique_ptr<Buffer> vbo;
         std::unique_ptr<Buffer> ibo;
-        unsigned int indices_count;
-        glm::vec3 color;
-        size_t id_;
-    public:
-        Isle(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id);
+        Material material;
+        std::vector<Vertex> vertices; //! Kept until upload()
+        std::vector<Index> indices; //! Kept until upload()
+        GLsizei indices_count{0};
+        std::vector<GLint> loops_first;
+        std::vector<GLsizei> loops_count;
 
-        Isle(Isle&& o) noexcept;
+        explicit Batch(const Material& material);
 
-        virtual ~Isle();
+        ~Batch();
 
-        void render(const Program& m_program);
+        void clear();
+
+        //! Uploads vertices and indices and frees them
+        void upload();
     };
 
-    class Contour {
-        std::unique_ptr<Buffer> vbo;
-        std::vector<unsigned int> start_ptrs;
-        glm::vec3 color;
-        size_t id_;
-    public:
-        Contour(const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id);
+    std::unique_ptr<Program> m_program;
+    int m_viewLoc;
+    int m_ambientScaleLoc;
+    int m_diffuseScaleLoc;
+    int m_specularLoc;
+    int m_shininessLoc;
+    std::unique_ptr<Batch> isles;
+    std::unique_ptr<Batch> polygons;
+    std::unique_ptr<Batch> contours;
 
-        Contour(Contour&& o) noexcept;
+    void setMaterial(const Material& material) const;
 
-        virtual ~Contour();
+    static void addPolygon(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id,
+                           float opacity = 1.0);
 
-        void render(const Program& m_program);
-    };
+    static void addIsle(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id);
 
-    std::unique_ptr<Program> m_program;
-    int m_viewLoc;
-    std::vector<Isle> glisles;
-    std::vector<Polygon> glpolygons;
-    std::vector<Contour> glcontours;
+    static void addContour(Batch& batch, const USV::Restrictions::Polygon& polygon, const glm::vec3& color, size_t id);
 };
 
 
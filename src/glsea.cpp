@@ -16,20 +16,17 @@ GLSea::GLSea() {
     m_program->link();
     m_program->bind();
 
-    auto ul_matrices = glGetUniformBlockIndex(m_program->programId(), "Matrices");
-    glUniformBlockBinding(m_program->programId(), ul_matrices, USV_GUI_MATRICES_BINDING);
-
-    auto ul_light = glGetUniformBlockIndex(m_program->programId(), "Light");
-    glUniformBlockBinding(m_program->programId(), ul_light, USV_GUI_LIGHTS_BINDING);
+    m_program->bindUniformBlock("Matrices", USV_GUI_MATRICES_BINDING);
+    m_program->bindUniformBlock("Light", USV_GUI_LIGHTS_BINDING);
 
     m_viewLoc = m_program->uniformLocation("viewPos");
     m_timeLoc = m_program->uniformLocation("time");
     m_program->setUniformValue(m_program->uniformLocation("height_scale"), 0.2f);
 
-    glUniform1i(m_program->uniformLocation("tex_normal"), 0);
-    glUniform1i(m_program->uniformLocation("depthMap"), 2);
-    glUniform1i(m_program->uniformLocation("specularMap"), 4);
-    vertexLocation = glGetAttribLocation(m_program->programId(), "vertex");
+    m_program->setUniformInt(m_program->uniformLocation("tex_normal"), 0);
+    m_program->setUniformInt(m_program->uniformLocation("depthMap"), 2);
+    m_program->setUniformInt(m_program->uniformLocation("specularMap"), 4);
+    vertexLocation = m_program->attributeLocation("vertex");
     m_program->release();
     vbo = std::make_unique<Buffer>();
     ibo = std::make_unique<Buffer>();
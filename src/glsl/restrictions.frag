@@ -3,13 +3,6 @@
 #define mediump
 #define lowp
 
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-};
-
 struct LightSource {
     vec4 position;
     vec3 ambient;
@@ -25,12 +18,17 @@ layout (std140) uniform Light
 };
 
 in highp mat3 TBN;
+in vec3 restriction_color;
+in float restriction_opacity;
+flat in uint restriction_id;
 layout(location = 0) out highp vec4 fragColor;
 layout (location = 1) out vec4 idB;
-uniform int _id;
 uniform highp vec3 viewPos;
-uniform Material material;
-uniform float opacity;
+// Material of geometry class, ambient and diffuse colors are restriction color scaled
+uniform float ambient_scale;
+uniform float diffuse_scale;
+uniform vec3 specular_color;
+uniform float shininess;
 in highp VERTEX_OUT{
     vec3 FragPos;
 } vertex_out;
@@ -39,16 +37,16 @@ void main() {
     idB = vec4(5,0,0,0);
     vec3 norm = normalize(TBN[2]);
     // ambient
-    vec3 ambient = light_ambient * material.ambient;
+    vec3 ambient = light_ambient * (restriction_color * ambient_scale);
     // diffuse
     vec3 lightDir = normalize(light_position.xyz);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light_diffuse * (diff * material.diffuse);
+    vec3 diffuse = light_diffuse * (diff * restriction_color * diffuse_scale);
     // specular
     vec3 viewDir = normalize(viewPos - vertex_out.FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light_specular * (spec * material.specular);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    vec3 specular = light_specular * (spec * specular_color);
     vec3 result = ambient + diffuse + specular;
-    fragColor = vec4(result, opacity);
+    fragColor = vec4(result, restriction_opacity);
 }
\ No newline at end of file
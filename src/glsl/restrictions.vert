@@ -5,8 +5,13 @@
 
 layout(location = 0) in vec4 vertex;
 layout(location = 1) in vec3 normal;
+layout(location = 2) in vec3 color;
+layout(location = 3) in float opacity;
+layout(location = 4) in uint id;
 out highp mat3 TBN;
-uniform mat4 m_view;
+out vec3 restriction_color;
+out float restriction_opacity;
+flat out uint restriction_id;
 out highp VERTEX_OUT{
     vec3 FragPos;
 } vertex_out;
@@ -24,4 +29,7 @@ void main() {
     vec3 Tangent2 = normalize(vec3(0, Normal.z, -Normal.x));
     TBN = mat3(Tangent, Tangent2, Normal);
     vertex_out.FragPos=vertex.xyz;
+    restriction_color = color;
+    restriction_opacity = opacity;
+    restriction_id = id;
 }
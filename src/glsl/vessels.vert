@@ -30,13 +30,52 @@ layout (std140) uniform Matrices
     mat4 view;
 };
 
+// Instances are case paths evaluated at time instead of per-instance attributes
+uniform bool paths_mode;
+uniform float time;
+// Per path: start time, first segment, segments count, vessel type
+uniform samplerBuffer path_table;
+// 3 texels per segment: (end time, duration, start), (velocity, center offset), (angular speed, begin angle)
+uniform samplerBuffer segment_table;
+uniform vec3 vessel_colors[9];
+
 void main() {
-    mat4 rot = mat4(cos(w),sin(w),0,0, -sin(w),cos(w),0,0, 0,0,1,0, 0,0,0,1);
-    mat4 translate = mat4(1,0,0,0, 0,1,0,0, 0,0,1,0, position.x,position.y,position.z,1);
+    vec2 instance_position = position.xy;
+    float course = w;
+    vec3 color = col;
+    if (paths_mode) {
+        vec4 path = texelFetch(path_table, gl_InstanceID);
+        int first = int(path.y);
+        int last = first + int(path.z) - 1;
+        if (last < first || time < path.x || time > texelFetch(segment_table, 3 * last).x) {
+            // Outside of clip volume
+            gl_Position = vec4(0, 0, 2, 1);
+            return;
+        }
+        // First segment ending at or after time
+        while (first < last) {
+            int mid = (first + last) / 2;
+            if (texelFetch(segment_table, 3 * mid).x < time) first = mid + 1;
+            else last = mid;
+        }
+        vec4 s0 = texelFetch(segment_table, 3 * first);
+        vec4 s1 = texelFetch(segment_table, 3 * first + 1);
+        vec4 s2 = texelFetch(segment_table, 3 * first + 2);
+        float t = min(time - s0.x + s0.y, s0.y);
+        float alpha = s2.x * t;
+        vec2 offset = s1.zw;
+        vec2 rotated = vec2(cos(alpha) * offset.x - sin(alpha) * offset.y, sin(alpha) * offset.x + cos(alpha) * offset.y);
+        instance_position = s0.zw + t * s1.xy + offset - rotated;
+        course = s2.y + alpha;
+        color = vessel_colors[int(path.w)];
+    }
+
+    mat4 rot = mat4(cos(course),sin(course),0,0, -sin(course),cos(course),0,0, 0,0,1,0, 0,0,0,1);
+    mat4 translate = mat4(1,0,0,0, 0,1,0,0, 0,0,1,0, instance_position.x,instance_position.y,0,1);
     mat4 m_scale = mat4(scale,0,0,0, 0,scale,0,0, 0,0,scale,0, 0,0,0,1);
 
-    material.ambient = col*0.9;
-    material.diffuse = col;
+    material.ambient = color*0.9;
+    material.diffuse = color;
     material.specular = vec3(0.63, 0.63, 0.63);
     material.shininess = 32;
 
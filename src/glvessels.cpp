@@ -1,13 +1,18 @@
 #include "glvessels.h"
 #include "earcut.h"
 #include "utils.h"
+#include <algorithm>
 #include <cmath>
 #include <cmrc/cmrc.hpp>
 #include "Defines.h"
 #include "Program.h"
 #include "Buffer.h"
+#include "StreamBuffer.h"
 
 #define CIRCLE_POINTS_N 360
+#define VESSEL_INSTANCE_COMPONENTS_N 7
+// Size of vessel_colors in vessels.vert
+static_assert(static_cast<size_t>(Vessel::Type::End) == 9, "vessel_colors size in vessels.vert doesn't match");
 const glm::vec3 vessel_vertices[] = {
         {-0.43301270189f * 0.1f, 0.0f,         0.01f},
         {0.43301270189f * 0.2f,  0.0f,         0.0f},
@@ -34,19 +39,31 @@ GLVessels::GLVessels() {
     m_program->link();
     m_program->bind();
 
-    auto ul_matrices = glGetUniformBlockIndex(m_program->programId(), "Matrices");
-    glUniformBlockBinding(m_program->programId(), ul_matrices, USV_GUI_MATRICES_BINDING);
-
-    auto ul_light = glGetUniformBlockIndex(m_program->programId(), "Light");
-    glUniformBlockBinding(m_program->programId(), ul_light, USV_GUI_LIGHTS_BINDING);
+    m_program->bindUniformBlock("Matrices", USV_GUI_MATRICES_BINDING);
+    m_program->bindUniformBlock("Light", USV_GUI_LIGHTS_BINDING);
 
     m_viewLoc = m_program->uniformLocation("viewPos");
 
     m_program->setUniformValue(m_program->uniformLocation("opacity"), 1.0f);
+    m_program->setUniformInt(m_program->uniformLocation("path_table"), USV_GUI_PATH_TABLE_UNIT);
+    m_program->setUniformInt(m_program->uniformLocation("segment_table"), USV_GUI_SEGMENT_TABLE_UNIT);
+    m_paths_mode_loc = m_program->uniformLocation("paths_mode");
+    m_time_loc = m_program->uniformLocation("time");
+    m_colors_loc = m_program->uniformLocation("vessel_colors");
     m_program->release();
 
-    m_vessels = std::make_unique<Buffer>();
-    m_vessels->create();
+    GLint max_texels{0};
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    max_table_texels = static_cast<size_t>(std::max(max_texels, 0));
+    glGenBuffers(1, &m_path_table_buffer);
+    glGenBuffers(1, &m_segment_table_buffer);
+    glGenTextures(1, &m_path_table);
+    glGenTextures(1, &m_segment_table);
+
+    m_vessels = std::make_unique<StreamBuffer>();
+
+    m_init_positions = std::make_unique<Buffer>();
+    m_init_positions->create();
 
     m_vessel_vbo = std::make_unique<Buffer>();
     m_vessel_vbo->create();
@@ -103,38 +120,80 @@ GLVessels::GLVessels() {
     }
 }
 
+GLVessels::~GLVessels() {
+    glDeleteTextures(1, &m_path_table);
+    glDeleteTextures(1, &m_segment_table);
+    glDeleteBuffers(1, &m_path_table_buffer);
+    glDeleteBuffers(1, &m_segment_table_buffer);
+}
+
 void GLVessels::render(glm::vec3 eyePos) {
+    m_program->bind();
     m_program->setUniformValue(m_viewLoc, eyePos);
+    m_program->setUniformInt(m_paths_mode_loc, 0);
+    draw(init_positions_count, m_init_positions->bufferId());
+    if (vessels_count > 0) {
+        draw(vessels_count, m_vessels->bufferId(), vessels_offset);
+        m_vessels->fence();
+    }
+
+    if (!evaluate_on_gpu || table_paths_count == 0) return;
+    glm::vec3 colors[static_cast<size_t>(Vessel::Type::End)];
+    for (size_t i = 0; i < static_cast<size_t>(Vessel::Type::End); ++i)
+        colors[i] = appearance_settings.vessels_colors[i];
+    m_program->setUniformArray(m_colors_loc, colors, static_cast<GLsizei>(Vessel::Type::End));
+    m_program->setUniformValue(m_time_loc, table_time);
+    m_program->setUniformInt(m_paths_mode_loc, 1);
+    glActiveTexture(GL_TEXTURE0 + USV_GUI_PATH_TABLE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_path_table);
+    glActiveTexture(GL_TEXTURE0 + USV_GUI_SEGMENT_TABLE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, m_segment_table);
+    draw(table_paths_count, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0 + USV_GUI_PATH_TABLE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    m_program->setUniformInt(m_paths_mode_loc, 0);
+}
+
+void GLVessels::draw(GLsizei instancecount, GLuint records, GLintptr offset) {
+    if (instancecount == 0) return;
+    const bool paths_mode = records == 0;
+    const auto record_offset = [offset](size_t component) {
+        return reinterpret_cast<void*>(offset + static_cast<GLintptr>(component * sizeof(float)));
+    };
     // Draw vessels
     m_vessel_vbo->bind();
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
-//    glVertexAttrib3f(1, 0.0f,0.0f,1.0f);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(5);
     // layout(location = 0) in vec4 vertex;
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
     // layout(location = 1) in vec3 normal;
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*) (3 * sizeof(GLfloat)));
     m_vessel_vbo->release();
-    m_vessels->bind();
 
-    glVertexAttribDivisor(2, 1); // layout(location = 2) in vec4 position;
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*) nullptr);
+    // In paths mode position, course and color come from path tables
+    if (!paths_mode) {
+        glBindBuffer(GL_ARRAY_BUFFER, records);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(5);
 
-    glVertexAttribDivisor(3, 1); // layout(location = 3) in float w;
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*) (2 * sizeof(float)));
+        glVertexAttribDivisor(2, 1); // layout(location = 2) in vec4 position;
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, VESSEL_INSTANCE_COMPONENTS_N * sizeof(float), record_offset(0));
 
-    glVertexAttribDivisor(5, 1); // layout(location = 5) in vec3 color;
-    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*) (3 * sizeof(float)));
+        glVertexAttribDivisor(3, 1); // layout(location = 3) in float w;
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, VESSEL_INSTANCE_COMPONENTS_N * sizeof(float), record_offset(2));
 
+        glVertexAttribDivisor(5, 1); // layout(location = 5) in vec3 color;
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, VESSEL_INSTANCE_COMPONENTS_N * sizeof(float), record_offset(3));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glDisableVertexAttribArray(4);
     glVertexAttrib1f(4, 1.0f); //layout(location = 4) in float scale;
     glLineWidth(1.0f);
-    auto instancecount = (GLsizei) (vessels.size());
-    if (case_data_ != nullptr) instancecount += (GLsizei) case_data_->targets.size() + 1;
     glDrawArraysInstanced(GL_TRIANGLES, 0, (sizeof(vessel_vertices) / sizeof(glm::vec3)), instancecount);
-    m_vessels->release();
 
     // Circle
     m_circle_vbo->bind();
@@ -143,66 +202,168 @@ void GLVessels::render(glm::vec3 eyePos) {
     glDisableVertexAttribArray(1);
     glVertexAttrib3f(1, 0.0f, 0.0f, 1.0f);
     m_circle_vbo->release();
-    m_vessels->bind();
-    glEnableVertexAttribArray(4);
-    glVertexAttribDivisor(4, 1);
-    // layout(location = 4) in float scale;
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void*) (6 * sizeof(float)));
+    if (paths_mode) {
+        // Same radius for all case paths
+        glVertexAttrib1f(4, static_cast<GLfloat>(case_data_->radius));
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, records);
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+        // layout(location = 4) in float scale;
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, VESSEL_INSTANCE_COMPONENTS_N * sizeof(float), record_offset(6));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
     glDrawArraysInstanced(GL_LINE_LOOP, 0, CIRCLE_POINTS_N, instancecount);
-    glVertexAttribDivisor(0, 0);
-    glVertexAttribDivisor(1, 0);
-    glVertexAttribDivisor(2, 0);
-    glVertexAttribDivisor(3, 0);
-    glVertexAttribDivisor(4, 0);
-    glVertexAttribDivisor(5, 0);
-    m_vessels->release();
+    for (GLuint i = 2; i <= 5; ++i) {
+        glVertexAttribDivisor(i, 0);
+        glDisableVertexAttribArray(i);
+    }
+}
 
+void GLVessels::setVessels(const std::vector<Vessel>& new_vessels) {
+    vessels = new_vessels;
+    evaluate_on_gpu = false;
 }
 
 void GLVessels::updatePositions(const std::vector<Vessel>& new_vessels) {
-    vessels = new_vessels;
+    setVessels(new_vessels);
     updatePositions();
 }
 
 void GLVessels::updatePositions() {
-    std::vector<GLfloat> spos;
-    double radius = 0;
+    uploadVessels();
+    uploadInitPositions();
+}
+
+namespace {
+    Vessel::Type vessel_type(const USV::PathEnvelope& pe) {
+        switch (pe.pathType) {
+            case USV::PathType::TargetManeuver:
+                if (pe.ship->target_status == nullptr)
+                    return Vessel::Type::TargetUndefined;
+                return static_cast<Vessel::Type>(pe.ship->target_status->danger_level);
+            case USV::PathType::WastedManeuver:
+                return Vessel::Type::ShipOnWastedManeuver;
+            case USV::PathType::ShipManeuver:
+                return Vessel::Type::ShipOnManeuver;
+            case USV::PathType::Route:
+                return Vessel::Type::ShipOnRoute;
+            case USV::PathType::End:
+                break;
+        }
+        return Vessel::Type::TargetUndefined;
+    }
+}
+
+void GLVessels::setCaseData(const USV::CaseData* caseData) {
+    case_data_ = caseData;
+    vessels.clear();
+    path_types.clear();
+    evaluate_on_gpu = false;
+    if (case_data_ == nullptr) {
+        trajectories = {};
+        table_paths_count = 0;
+        vessels_count = 0;
+        uploadInitPositions();
+        return;
+    }
+    trajectories = USV::TrajectoryTable(case_data_->paths);
+    path_types.reserve(case_data_->paths.size());
+    for (const auto& pe: case_data_->paths)
+        path_types.push_back(vessel_type(pe));
+    uploadTables();
+    uploadVessels();
+    uploadInitPositions();
+}
+
+void GLVessels::uploadTables() {
+    table_paths_count = 0;
+    const auto segments_texels = trajectories.segmentsCount() * USV::TrajectoryTable::segment_record_size / 4;
+    if (trajectories.pathsCount() == 0 || segments_texels > max_table_texels ||
+        trajectories.pathsCount() > max_table_texels)
+        return;
+
+    table_time_origin = case_data_->min_time;
+    std::vector<float> paths, segments;
+    trajectories.exportRecords(table_time_origin, paths, segments);
+    for (size_t p = 0; p < path_types.size(); ++p)
+        paths[p * USV::TrajectoryTable::path_record_size + 3] = static_cast<float>(path_types[p]);
+
+    auto upload = [](GLuint buffer, GLuint texture, const std::vector<float>& data) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(sizeof(float) * data.size()), data.data(),
+                     GL_STATIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    };
+    upload(m_path_table_buffer, m_path_table, paths);
+    upload(m_segment_table_buffer, m_segment_table, segments);
+    table_paths_count = static_cast<GLsizei>(trajectories.pathsCount());
+}
+
+void GLVessels::updateCaseTime(double time) {
+    if (case_data_ == nullptr) return;
+    // Vessels list is evaluated on CPU for captions either way
+    positions.resize(trajectories.pathsCount() * 3);
+    instance_paths.resize(trajectories.pathsCount());
+    const auto count = trajectories.evaluate(time, positions.data(), 3, instance_paths.data());
+    vessels.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto path_index = instance_paths[i];
+        const auto* p = positions.data() + i * 3;
+        vessels[i] = {case_data_->paths[path_index].ship, {p[0], p[1]}, p[2], case_data_->radius,
+                      path_types[path_index]};
+    }
+
+    evaluate_on_gpu = table_paths_count > 0;
+    table_time = static_cast<float>(time - table_time_origin);
+    uploadVessels();
+}
+
+namespace {
+    void write_instance(float* record, const USV::Vector2& position, double course, const glm::vec4& color,
+                        double radius) {
+        record[0] = static_cast<GLfloat>(position.x());
+        record[1] = static_cast<GLfloat>(position.y());
+        record[2] = static_cast<GLfloat>(course);
+        record[3] = color.r;
+        record[4] = color.g;
+        record[5] = color.b;
+        record[6] = static_cast<GLfloat>(radius);
+    }
+}
+
+void GLVessels::uploadVessels() {
+    vessels_count = evaluate_on_gpu ? 0 : static_cast<GLsizei>(vessels.size());
+    if (vessels_count == 0) return;
+    auto* record = static_cast<float*>(m_vessels->map(sizeof(float) * VESSEL_INSTANCE_COMPONENTS_N * vessels.size()));
     for (const auto& v: vessels) {
-        auto color = appearance_settings.vessels_colors[static_cast<size_t>(v.type)];
-        radius = v.radius;
-        spos.push_back(static_cast<GLfloat>(v.position.x()));
-        spos.push_back(static_cast<GLfloat>(v.position.y()));
-        spos.push_back(static_cast<GLfloat>(v.course));
-        spos.push_back(color.r);
-        spos.push_back(color.g);
-        spos.push_back(color.b);
-        spos.push_back(static_cast<GLfloat>(v.radius));
+        write_instance(record, v.position, v.course, appearance_settings.vessels_colors[static_cast<size_t>(v.type)],
+                       v.radius);
+        record += VESSEL_INSTANCE_COMPONENTS_N;
     }
-    if (case_data_ != nullptr) {
-        auto color = appearance_settings.vessels_colors[static_cast<size_t>(Vessel::Type::TargetInitPosition)];
-        for (const auto& t: case_data_->targets) {
-            spos.push_back(static_cast<GLfloat>(t.initPosition.point.x()));
-            spos.push_back(static_cast<GLfloat>(t.initPosition.point.y()));
-            spos.push_back(static_cast<GLfloat>(t.initPosition.course.radians()));
-            spos.push_back(color.r);
-            spos.push_back(color.g);
-            spos.push_back(color.b);
-            spos.push_back(static_cast<GLfloat>(radius));
-        }
+    vessels_offset = m_vessels->unmap();
+    StreamBuffer::release();
+}
 
-        color = appearance_settings.vessels_colors[static_cast<size_t>(Vessel::Type::ShipInitPosition)];
-        {
-            const auto& ownShip = case_data_->ownShip;
-            spos.push_back(static_cast<GLfloat>(ownShip.initPosition.point.x()));
-            spos.push_back(static_cast<GLfloat>(ownShip.initPosition.point.y()));
-            spos.push_back(static_cast<GLfloat>(ownShip.initPosition.course.radians()));
-            spos.push_back(color.r);
-            spos.push_back(color.g);
-            spos.push_back(color.b);
-            spos.push_back(static_cast<GLfloat>(radius));
-        }
+void GLVessels::uploadInitPositions() {
+    std::vector<float> instances;
+    if (case_data_ != nullptr) {
+        instances.resize((case_data_->targets.size() + 1) * VESSEL_INSTANCE_COMPONENTS_N);
+        auto* record = instances.data();
+        auto push_init_position = [&](const USV::Path::Position& position, Vessel::Type type) {
+            write_instance(record, position.point, position.course.radians(),
+                           appearance_settings.vessels_colors[static_cast<size_t>(type)], case_data_->radius);
+            record += VESSEL_INSTANCE_COMPONENTS_N;
+        };
+        for (const auto& t: case_data_->targets)
+            push_init_position(t.initPosition, Vessel::Type::TargetInitPosition);
+        push_init_position(case_data_->ownShip.initPosition, Vessel::Type::ShipInitPosition);
     }
-    m_vessels->bind();
-    m_vessels->allocate(spos.data(), (int) (sizeof(GLfloat) * spos.size()));
-    m_vessels->release();
+    init_positions_count = static_cast<GLsizei>(instances.size() / VESSEL_INSTANCE_COMPONENTS_N);
+    m_init_positions->bind();
+    m_init_positions->allocate(instances.data(), (int) (sizeof(GLfloat) * instances.size()));
+    m_init_positions->release();
 }
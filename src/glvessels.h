@@ -3,6 +3,8 @@
 
 #include "usvdata/Restrictions.h"
 #include "usvdata/CaseData.h"
+#include "usvdata/TrajectoryTable.h"
+#include "Buffer.h"
 #include <glm/glm.hpp>
 #include <utility>
 #include <memory>
@@ -10,7 +12,7 @@
 
 class Program;
 
-class Buffer;
+class StreamBuffer;
 
 struct Vessel {
 
@@ -37,9 +39,18 @@ struct Vessel {
 class GLVessels {
     std::unique_ptr<Program> m_program;
     std::unique_ptr<Buffer> m_vessel_vbo{};
-    std::unique_ptr<Buffer> m_vessels{};
+    std::unique_ptr<StreamBuffer> m_vessels{}; // Vessels list instances, rewritten on updates
+    std::unique_ptr<Buffer> m_init_positions{}; // Initial positions instances, written with case and colors
     std::unique_ptr<Buffer> m_circle_vbo{};
     int m_viewLoc;
+    GLint m_paths_mode_loc;
+    GLint m_time_loc;
+    GLint m_colors_loc;
+    // Texture buffers with TrajectoryTable records, vessels.vert evaluates case paths from them
+    GLuint m_path_table_buffer{};
+    GLuint m_path_table{};
+    GLuint m_segment_table_buffer{};
+    GLuint m_segment_table{};
     const USV::CaseData* case_data_{};
 public:
     struct AppearanceSettings {
@@ -49,24 +60,66 @@ private:
     std::vector<Vessel> vessels{};
 
     AppearanceSettings appearance_settings{};
+
+    USV::TrajectoryTable trajectories{};
+    std::vector<Vessel::Type> path_types{};
+    GLsizei vessels_count{0}; // Instances in m_vessels
+    GLintptr vessels_offset{0};
+    GLsizei init_positions_count{0};
+    std::vector<float> positions{};
+    std::vector<uint32_t> instance_paths{};
+
+    size_t max_table_texels{0};
+    GLsizei table_paths_count{0}; // 0 if there are no tables, e.g. case exceeds GL_MAX_TEXTURE_BUFFER_SIZE
+    double table_time_origin{0}; // Table times are relative to it to fit float
+    float table_time{0};
+    bool evaluate_on_gpu{false}; // Vessels list is drawn from path tables, not from instances
+
+    /**
+     * Writes instances of vessels list, none if it is evaluated on GPU
+     */
+    void uploadVessels();
+
+    /**
+     * Uploads instances of targets and own ship initial positions
+     */
+    void uploadInitPositions();
+
+    /**
+     * Uploads trajectories to path tables, leaves them empty if they don't fit
+     */
+    void uploadTables();
+
+    /**
+     * Draws vessels and their circles
+     * @param records Buffer of instance records, 0 to draw case paths evaluated in shader from path tables
+     * @param offset Byte offset of the first record
+     */
+    void draw(GLsizei instancecount, GLuint records, GLintptr offset = 0);
+
 public:
     GLVessels();
 
+    ~GLVessels();
+
+    GLVessels(const GLVessels&) = delete;
+
+    GLVessels& operator=(const GLVessels&) = delete;
+
     [[nodiscard]] const std::vector<Vessel>& getVessels() const {
         return vessels;
     }
 
-    void setVessels(const std::vector<Vessel>& new_vessels) {
-        vessels = new_vessels;
-    }
+    /**
+     * Replaces vessels evaluated from case paths until next updateCaseTime()
+     */
+    void setVessels(const std::vector<Vessel>& new_vessels);
 
     [[nodiscard]] const USV::CaseData* getCaseData() const {
         return case_data_;
     }
 
-    void setCaseData(const USV::CaseData* caseData) {
-        case_data_ = caseData;
-    }
+    void setCaseData(const USV::CaseData* caseData);
 
     [[nodiscard]] const AppearanceSettings& getAppearanceSettings() const {
         return appearance_settings;
@@ -82,6 +135,14 @@ public:
 
     void updatePositions();
 
+    /**
+     * Evaluates positions of all case paths at time for vessels list. Drawing evaluates them in
+     * vessels.vert from path tables uploaded by setCaseData(), nothing is uploaded here unless
+     * tables are unavailable.
+     * @param time Case time [sec]
+     */
+    void updateCaseTime(double time);
+
 };
 
 
@@ -21,7 +21,14 @@
 
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include "App.h"
+#include "usvdata/BatchRun.h"
+#ifdef USV_GUI_HEADLESS
+#include "HeadlessRenderer.h"
+#endif
 
 #define MAIN_WINDOW_WIDTH 800
 #define MAIN_WINDOW_HEIGHT 600
@@ -36,8 +43,110 @@ void printGlfwError(){
     }
 }
 
-int main(int /* argc */, char** /* argv */) {
+void printUsage() {
+    std::cerr << "usage: usv-gui [--batch-run <root> [--usv executable] [--jobs N] [--timeout sec] [--summary file]]"
+              << std::endl;
+#ifdef USV_GUI_HEADLESS
+    std::cerr << "       usv-gui [--render <case_dir> --out <dir> [--times t0:t1:step] [--size WxH] [--jobs N] [--font file.ttf]]"
+              << std::endl;
+#endif
+}
+
+int batchRun(int argc, char** argv) {
+    USV::BatchRun::Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            printUsage();
+            return 2;
+        }
+        ++i;
+        if (!strcmp(arg, "--batch-run")) {
+            options.root = value;
+        } else if (!strcmp(arg, "--usv")) {
+            options.executable = value;
+        } else if (!strcmp(arg, "--jobs")) {
+            options.jobs = static_cast<size_t>(std::max(0, atoi(value)));
+        } else if (!strcmp(arg, "--timeout")) {
+            options.timeout = std::max(0.0, atof(value));
+        } else if (!strcmp(arg, "--summary")) {
+            options.summary = value;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (options.executable.empty()) {
+        // Executable selected in GUI
+        std::ifstream saved(App::usv_executable_filename);
+        std::string path;
+        if (saved >> path) options.executable = path;
+    }
+    if (options.root.empty() || options.executable.empty()) {
+        printUsage();
+        return 2;
+    }
+    try {
+        return USV::BatchRun::run(options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
+
+#ifdef USV_GUI_HEADLESS
+
+int render(int argc, char** argv) {
+    HeadlessRenderer::Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            printUsage();
+            return 2;
+        }
+        ++i;
+        if (!strcmp(arg, "--render")) {
+            options.case_directory = value;
+        } else if (!strcmp(arg, "--out")) {
+            options.output_directory = value;
+        } else if (!strcmp(arg, "--times")) {
+            if (!HeadlessRenderer::parseTimes(value, options)) {
+                std::cerr << "Bad --times value: " << value << std::endl;
+                return 2;
+            }
+        } else if (!strcmp(arg, "--size")) {
+            if (sscanf(value, "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 ||
+                options.height <= 0) {
+                std::cerr << "Bad --size value: " << value << std::endl;
+                return 2;
+            }
+        } else if (!strcmp(arg, "--jobs")) {
+            options.workers = static_cast<unsigned>(std::max(0, atoi(value)));
+        } else if (!strcmp(arg, "--font")) {
+            options.font = value;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (options.case_directory.empty() || options.output_directory.empty()) {
+        printUsage();
+        return 2;
+    }
+    return HeadlessRenderer::render(options);
+}
+#endif
+
+int main(int argc, char** argv) {
     std::cout << "usv-gui " COMPLETE_VERSION << std::endl;
+    if (argc > 1 && !strcmp(argv[1], "--batch-run"))
+        return batchRun(argc, argv);
+#ifdef USV_GUI_HEADLESS
+    if (argc > 1 && !strcmp(argv[1], "--render"))
+        return render(argc, argv);
+#endif
 //HIDE OWN CONSOLE WINDOW BUT still output to CLI (DIRTY)
 #ifdef WIN32
     HWND consoleWnd = GetConsoleWindow();
@@ -6,14 +6,34 @@
 #include <GLFW/glfw3.h>
 #include "Defines.h"
 #include "Compass.h"
-#include "Buffer.h"
+#include "PathBuffer.h"
 #include "glsea.h"
 #include "glgrid.h"
 #include "glrestrictions.h"
-#include <sstream>
+#include "usvdata/SpatialIndex.h"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
 
 #define FOV 90.0f
 #define PATH_POINT_MARK_N 5
+// Labels anchored this far outside of viewport [px] may still show a part
+#define LABEL_CULL_MARGIN 64.0f
+
+namespace {
+    // Same text as stream << std::setw(5) << degrees << "°"
+    template<size_t N>
+    void format_course(double degrees, char (&text)[N]) {
+        char number[N];
+        const auto end = std::to_chars(std::begin(number), std::end(number) - 3, degrees,
+                                       std::chars_format::general, 6).ptr;
+        const auto length = static_cast<size_t>(end - number);
+        const auto padding = length < 5 ? 5 - length : 0;
+        std::fill_n(text, padding, ' ');
+        std::copy(number, end, text + padding);
+        std::copy_n("\xC2\xB0", 3, text + padding + length); // degree sign in UTF-8 with terminator
+    }
+}
 
 static const char* vertexShaderSource =
         "#version 330\n"
@@ -89,8 +109,10 @@ void OGLWidget::initializeGL() {
 
     m_program->bind();
 
-    m_paths = std::make_unique<Buffer>();
-    m_paths->create();
+    // Start point marker shape goes first, paths after it
+    m_paths = std::make_unique<PathBuffer>(std::vector<GLfloat>{0, -1, 0, -0.3f, 0.3f, 0, 0, 0.3f, 0, 1});
+    m_markers = std::make_unique<Buffer>();
+    m_markers->create();
 
     grid = std::make_unique<GLGrid>();
     sea = std::make_unique<GLSea>();
@@ -193,31 +215,39 @@ void OGLWidget::paintGL(NVGcontext *ctx) {
         glVertexAttrib4f(1, 0.0f, 0.0f, 0.0f, 0.0f);
         m_paths->release();
 
-        for (const auto &path_meta:m_paths_meta) {
-            const auto& color = appearance_settings.path_colors[static_cast<size_t>(path_meta.type)];
+        for (size_t type = 0; type < static_cast<size_t>(USV::PathType::End); ++type) {
+            const auto& draws = m_paths_draws[type];
+            if (draws.first.empty()) continue;
+            const auto& color = appearance_settings.path_colors[type];
             glVertexAttrib3f(3, color.x, color.y, color.z);
-            glDrawArrays(GL_LINE_STRIP, (GLint) path_meta.ptr, (GLsizei) path_meta.points_count);
+            glMultiDrawArrays(GL_LINE_STRIP, draws.first.data(), draws.count.data(), (GLsizei) draws.first.size());
         }
 
-        // Paths start points
+        // Paths start points, marker shape is the prefix of paths buffer
         m_paths->bind();
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+        m_markers->bind();
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(1, 1); // layout(location = 1) in vec4 position;
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), nullptr);
+        glVertexAttribDivisor(2, 1); // layout(location = 2) in float w;
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*) (2 * sizeof(GLfloat)));
+        glVertexAttribDivisor(3, 1); // layout(location = 3) in vec3 col;
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*) (3 * sizeof(GLfloat)));
         glVertexAttrib1f(4, 0.05f); //scale
-        for (const auto &path_meta:m_paths_meta) {
-            const auto& color = appearance_settings.path_colors[static_cast<size_t>(path_meta.type)];
-            glVertexAttrib3f(3, color.x, color.y, color.z);
-            for (const auto& segment: path_meta.path->getSegments()) {
-                const auto start_point = segment.second.getStartPoint();
-                glVertexAttrib2f(1, (GLfloat) start_point.x(), (GLfloat) start_point.y());
-                glVertexAttrib1f(2, (GLfloat) segment.second.getBeginAngle().radians());
-                glDrawArrays(GL_LINE_LOOP, 0, PATH_POINT_MARK_N);
-            }
-        }
-        m_paths->release();
+        // All markers in one draw. Filtering by path type would need instances grouped by type and attribute
+        // pointers offset to each group, GL 3.3 has no base instance
+        glDrawArraysInstanced(GL_LINE_LOOP, 0, PATH_POINT_MARK_N, (GLsizei) m_markers_count);
+        m_markers->release();
         glVertexAttribDivisor(1, 0);
         glVertexAttribDivisor(2, 0);
         glVertexAttribDivisor(3, 0);
         glVertexAttribDivisor(4, 0);
+        glDisableVertexAttribArray(1);
+        glDisableVertexAttribArray(2);
+        glDisableVertexAttribArray(3);
 
         m_program->release();
 
@@ -231,77 +261,44 @@ void OGLWidget::paintGL(NVGcontext *ctx) {
         nvgFillColor(ctx, {1, 1.0, 1, 1});
         for (const auto& vessel : vessels->getVessels()) {
             auto coord = WorldToscreen({vessel.position.x(), vessel.position.y()});
+            if (!labelVisible(coord)) continue;
             nvgText(ctx, coord.x, coord.y, vessel.ship->name.c_str(), nullptr);
         }
 
         // Draw segments courses
-        for (const auto &path_meta:m_paths_meta) {
-            const auto& color = appearance_settings.path_colors[static_cast<size_t>(path_meta.type)];
-            if(path_meta.type == USV::PathType::WastedManeuver){
-                continue;
-            }
-            glVertexAttrib3f(3, color.x, color.y, color.z);
-            for (const auto& segment: path_meta.path->getSegments()) {
-                const auto start_point = segment.second.getStartPoint();
-                auto c = WorldToscreen({start_point.x(), start_point.y()});
-                nvgTranslate(ctx, c.x, c.y);
-                nvgRotate(ctx, (GLfloat) (-segment.second.getBeginAngle().radians() + rotation + M_PI_2));
-
-                std::stringstream tmp;
-                tmp << std::setw(5) << fmod(450 - segment.second.getBeginAngle().degrees(), 360) << "°";
-
-                nvgText(ctx, 0.0, 0.0, tmp.str().c_str(), nullptr);
-                nvgResetTransform(ctx);
-
-//                glVertexAttrib2f(1, (GLfloat) start_point.x(), (GLfloat) start_point.y());
-//                glVertexAttrib1f(2, (GLfloat) segment.second.getBeginAngle().radians());
-//                glDrawArrays(GL_LINE_LOOP, 0, PATH_POINT_MARK_N);
-            }
+        for (const auto& label: m_course_labels) {
+            auto c = WorldToscreen(label.position);
+            if (!labelVisible(c)) continue;
+            nvgTranslate(ctx, c.x, c.y);
+            nvgRotate(ctx, (GLfloat) (-label.angle + rotation + M_PI_2));
+            nvgText(ctx, 0.0, 0.0, label.text, nullptr);
+            nvgResetTransform(ctx);
         }
         // Draw distances
+        if (m_distances_dirty || m_distances_cap != distance_cap) updateDistances();
         {
             nvgTextAlign(ctx, NVG_ALIGN_CENTER | NVG_ALIGN_TOP);
             nvgFontSize(ctx, 14);
             nvgStrokeWidth(ctx, 1.0f);
             nvgStrokeColor(ctx, {1.0, 1.0, 1.0, 1.0});
-            const auto distance_capSq = distance_cap * distance_cap;
-            auto _vessels = vessels->getVessels();
-            for (size_t i = 0; i < _vessels.size(); ++i) {
-                const auto& a = _vessels[i].position;
-                if(_vessels[i].type==Vessel::Type::ShipOnWastedManeuver){
+            const glm::vec2 center{static_cast<float>(width) * 0.5f, static_cast<float>(height) * 0.5f};
+            for (const auto& label: m_distance_labels) {
+                const auto ca = WorldToscreen(label.a);
+                const auto cb = WorldToscreen(label.b);
+                // Point of line bounds closest to viewport center is in viewport unless they don't overlap
+                if (!labelVisible(glm::clamp(center, glm::min(ca, cb), glm::max(ca, cb))))
                     continue;
-                }
-                for (size_t j = i + 1; j < _vessels.size(); ++j) {
-                    if(_vessels[j].type==Vessel::Type::ShipOnWastedManeuver){
-                        continue;
-                    }
-                    const auto& b = _vessels[j].position;
-                    const auto ba = a - b;
-                    const auto ba_Sq = absSq(ba);
-                    if (ba_Sq > distance_capSq || ba_Sq < 1)
-                        continue;
-
-                    const auto m = (a + b) * 0.5;
-
-                    const auto angle = static_cast<float>(fmod(atan2(ba.x(), ba.y()) - M_PI, M_PI));
-                    auto c = WorldToscreen({a.x(), a.y()});
-
-                    nvgBeginPath(ctx);
-                    nvgMoveTo(ctx, c.x, c.y);
-                    c = WorldToscreen({b.x(), b.y()});
-                    nvgLineTo(ctx, c.x, c.y);
-                    c = WorldToscreen({m.x(), m.y()});
-                    nvgStroke(ctx);
-
-                    nvgTranslate(ctx, c.x, c.y);
-                    nvgRotate(ctx, angle + rotation);
-
-                    std::stringstream tmp;
-                    tmp << std::fixed << std::setprecision( 2 ) << abs(ba);
-
-                    nvgText(ctx, 0.0, 0.0, tmp.str().c_str(), nullptr);
-                    nvgResetTransform(ctx);
-                }
+
+                nvgBeginPath(ctx);
+                nvgMoveTo(ctx, ca.x, ca.y);
+                nvgLineTo(ctx, cb.x, cb.y);
+                nvgStroke(ctx);
+
+                const auto c = WorldToscreen((label.a + label.b) * 0.5f);
+                nvgTranslate(ctx, c.x, c.y);
+                nvgRotate(ctx, label.angle + rotation);
+                nvgText(ctx, 0.0, 0.0, label.text, nullptr);
+                nvgResetTransform(ctx);
             }
         }
     }
@@ -373,44 +370,134 @@ void OGLWidget::loadData(std::unique_ptr<USV::CaseData> case_data) {
 //        End
 //    };
 
-    std::vector<GLfloat> paths;
-    paths.push_back(static_cast<float>(0));paths.push_back(static_cast<float>(-1));
-    paths.push_back(static_cast<float>(0));paths.push_back(static_cast<float>(-0.3));
-    paths.push_back(static_cast<float>(0.3));paths.push_back(static_cast<float>(0.0));
-    paths.push_back(static_cast<float>(0));paths.push_back(static_cast<float>(0.3));
-    paths.push_back(static_cast<float>(0));paths.push_back(static_cast<float>(1));
-    m_paths_meta.clear();
-    for (const auto &pe : caseData.paths) {
-        auto path_points = pe.path.getPointsPath();
-        size_t ptr = paths.size() / 2;
-        for (const auto &v: path_points) {
-            paths.push_back(static_cast<float>(v.x()));
-            paths.push_back(static_cast<float>(v.y()));
+    uploadPaths();
+    m_distances_dirty = true;
+
+    restrictions->load_restrictions(caseData.restrictions);
+}
+
+void OGLWidget::reloadChanged(const USV::CaseCache::CaseChanges& changes) {
+    if (!case_data_) return;
+    USV::CaseCache::reloadChanged(*case_data_, changes);
+    if (!changes.paths.empty() || changes.analyse) {
+        vessels->setCaseData(case_data_.get());
+        m_distances_dirty = true;
+    }
+    if (!changes.paths.empty())
+        uploadPaths();
+    if (changes.restrictions)
+        restrictions->load_restrictions(case_data_->restrictions);
+}
+
+void OGLWidget::uploadPaths() {
+    // Paths kept since the last upload keep their place in the buffer, only new ones are written
+    const auto& ranges = m_paths->update(case_data_->paths);
+    for (auto& draws: m_paths_draws) {
+        draws.first.clear();
+        draws.count.clear();
+    }
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const auto& pe = case_data_->paths[i];
+        auto& draws = m_paths_draws[static_cast<size_t>(pe.pathType)];
+        draws.first.push_back(ranges[i].first);
+        draws.count.push_back(ranges[i].count);
+    }
+    uploadMarkers();
+    buildLabels();
+}
+
+void OGLWidget::buildLabels() {
+    m_course_labels.clear();
+    for (const auto& pe: case_data_->paths) {
+        if (pe.pathType == USV::PathType::WastedManeuver) continue;
+        for (const auto& segment: pe.path.getSegments()) {
+            const auto start_point = segment.second.getStartPoint();
+            const auto& angle = segment.second.getBeginAngle();
+            auto& label = m_course_labels.emplace_back();
+            label.position = {start_point.x(), start_point.y()};
+            label.angle = static_cast<float>(angle.radians());
+            format_course(fmod(450 - angle.degrees(), 360), label.text);
         }
-        m_paths_meta.emplace_back(ptr, &pe.path, path_points.size(), pe.pathType);
     }
+}
 
-    m_paths->bind();
-    m_paths->allocate(paths.data(), (int) (sizeof(GLfloat) * paths.size()));
-    m_paths->release();
+void OGLWidget::updateDistances() {
+    m_distance_labels.clear();
+    m_distances_dirty = false;
+    m_distances_cap = distance_cap;
+    const auto& _vessels = vessels->getVessels();
+    std::vector<USV::Vector2> positions;
+    for (const auto& vessel: _vessels)
+        if (vessel.type != Vessel::Type::ShipOnWastedManeuver) positions.push_back(vessel.position);
+
+    // Only vessels in neighbouring grid cells can be within distance_cap
+    const USV::PointGrid grid(positions, distance_cap);
+    std::vector<std::pair<size_t, size_t>> pairs;
+    grid.forEachPair([&pairs](size_t i, size_t j) { pairs.emplace_back(i, j); });
+    // Keep the order of vessels list, labels overlap the same way every time
+    std::sort(pairs.begin(), pairs.end());
+    for (const auto& [i, j]: pairs) {
+        const auto& a = positions[i];
+        const auto& b = positions[j];
+        const auto ba = a - b;
+        if (absSq(ba) < 1) continue;
+        auto& label = m_distance_labels.emplace_back();
+        label.a = {a.x(), a.y()};
+        label.b = {b.x(), b.y()};
+        label.angle = static_cast<float>(fmod(atan2(ba.x(), ba.y()) - M_PI, M_PI));
+        *std::to_chars(std::begin(label.text), std::end(label.text) - 1, abs(ba), std::chars_format::fixed, 2).ptr = '\0';
+    }
+}
 
-    restrictions->load_restrictions(caseData.restrictions);
+bool OGLWidget::labelVisible(glm::vec2 screen_pos) const {
+    return screen_pos.x >= -LABEL_CULL_MARGIN && screen_pos.y >= -LABEL_CULL_MARGIN &&
+           screen_pos.x <= static_cast<float>(width) + LABEL_CULL_MARGIN &&
+           screen_pos.y <= static_cast<float>(height) + LABEL_CULL_MARGIN;
+}
+
+void OGLWidget::uploadMarkers() {
+    std::vector<GLfloat> instances;
+    for (const auto& pe: case_data_->paths) {
+        const auto& color = appearance_settings.path_colors[static_cast<size_t>(pe.pathType)];
+        for (const auto& segment: pe.path.getSegments()) {
+            const auto start_point = segment.second.getStartPoint();
+            instances.insert(instances.end(), {(GLfloat) start_point.x(), (GLfloat) start_point.y(),
+                                               (GLfloat) segment.second.getBeginAngle().radians(),
+                                               color.x, color.y, color.z});
+        }
+    }
+    m_markers_count = instances.size() / 6;
+    m_markers->bind();
+    m_markers->allocate(instances.data(), (GLsizeiptr) (sizeof(GLfloat) * instances.size()));
+    m_markers->release();
 }
 
 
 void OGLWidget::updatePositions(const std::vector<Vessel>& new_vessels) {
     vessels->setVessels(new_vessels);
     vessels->updatePositions();
+    m_distances_dirty = true;
 }
 
 void OGLWidget::updatePositions() {
     vessels->updatePositions();
+    m_distances_dirty = true;
 }
 
 void OGLWidget::updateTime(double t) {
     time = t;
 }
 
+void OGLWidget::updateCaseTime(double case_time) {
+    if (!case_data_) return;
+    vessels->updateCaseTime(case_time);
+    // Same time after e.g. resize or replay keeps distance labels
+    m_distances_dirty |= case_time != m_distances_time;
+    m_distances_time = case_time;
+    updateTime(case_time / 3600);
+    updateSunAngle(static_cast<long>(case_time), case_data_->frame.getRefLat(), case_data_->frame.getRefLon());
+}
+
 
 void OGLWidget::mousePressEvent(double x, double y, int /*button*/, int /*mods*/) {
     auto world_position = screenToWorld({x, y});
@@ -520,11 +607,8 @@ void OGLWidget::updateSunAngle(long timestamp, double lat, double /*lon*/) {
     };
 
     // Light Uniform buffer
-    glGenBuffers(1, &ubo_light);
-
     glBindBuffer(GL_UNIFORM_BUFFER, ubo_light);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightSource), &light, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, USV_GUI_LIGHTS_BINDING, ubo_light);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightSource), &light);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
@@ -574,6 +658,7 @@ void OGLWidget::updateAppearanceSettings(const OGLWidget::AppearanceSettings &se
     };
     sea->set_material(sea_material);
     vessels->setAppearanceSettings(appearance_settings.vessels_colors);
+    if (case_data_) uploadMarkers();
 }
 
 const OGLWidget::AppearanceSettings &OGLWidget::getAppearanceSettings() const {
@@ -1,6 +1,7 @@
 #ifndef OGLWIDGET_H
 #define OGLWIDGET_H
 
+#include "usvdata/CaseCache.h"
 #include "usvdata/CaseData.h"
 #include "glvessels.h"
 #include <glm/glm.hpp>
@@ -10,7 +11,7 @@ class Compass;
 
 class Program;
 
-class Buffer;
+class PathBuffer;
 
 class GLSea;
 
@@ -46,12 +47,24 @@ public:
 
     void loadData(std::unique_ptr<USV::CaseData> case_data);
 
+    /**
+     * Reload changed files into current case and upload only affected GL data
+     * @throws std::runtime_error if files can't be loaded, current case is kept then
+     */
+    void reloadChanged(const USV::CaseCache::CaseChanges& changes);
+
     void updatePositions(const std::vector<Vessel> &vessels);
 
     void updatePositions();
 
     void updateTime(double t);
 
+    /**
+     * Move the whole scene to case time: vessels positions, sea animation and sun
+     * @param time Case time [sec]
+     */
+    void updateCaseTime(double time);
+
     void scroll([[maybe_unused]] double dx, double dy);
 
     void keyPress(int key);
@@ -69,22 +82,43 @@ public:
 protected:
     unsigned int vao{};
     std::unique_ptr<Program> m_program{nullptr};
-    std::unique_ptr<Buffer> m_paths{};
+    std::unique_ptr<PathBuffer> m_paths{};
+    std::unique_ptr<Buffer> m_markers{}; // Segment start marker instances: start point, begin angle, color
     unsigned int ubo_matrices{};
     unsigned int ubo_light{};
     AppearanceSettings appearance_settings;
 
-    struct pathVBOMeta {
-        size_t ptr;
-        const USV::Path* path;
-        size_t points_count;
-        USV::PathType type;
+    //! glMultiDrawArrays arguments of paths of each type
+    struct pathsDraw {
+        std::vector<GLint> first;
+        std::vector<GLsizei> count;
+    };
+
+    pathsDraw m_paths_draws[static_cast<size_t>(USV::PathType::End)];
+
+    struct courseLabel {
+        glm::vec2 position; // Segment start point
+        float angle; // Segment begin angle [rad]
+        char text[20];
+    };
+
+    //! Course labels of segments, formatted when paths are uploaded
+    std::vector<courseLabel> m_course_labels;
 
-        pathVBOMeta(size_t ptr, const USV::Path* path, size_t points_count, USV::PathType path_type) : ptr(ptr), path(
-                path), points_count(points_count), type(path_type) {};
+    struct distanceLabel {
+        glm::vec2 a;
+        glm::vec2 b;
+        float angle;
+        char text[32];
     };
 
-    std::vector<pathVBOMeta> m_paths_meta;
+    //! Distance labels of vessel pairs within distance_cap, rebuilt when vessels move
+    std::vector<distanceLabel> m_distance_labels;
+    bool m_distances_dirty{true};
+    double m_distances_cap{0};
+    double m_distances_time{0};
+
+    size_t m_markers_count{0};
     glm::ivec2 mouse_press_point{};
 
     int m_myMatrixLoc{};
@@ -110,6 +144,21 @@ protected:
 
     void updateUniforms();
 
+    //! Update paths buffer and meta from case data
+    void uploadPaths();
+
+    //! Rebuild segment start marker instances from case data and path colors
+    void uploadMarkers();
+
+    //! Format course labels of case segments
+    void buildLabels();
+
+    //! Find vessel pairs within distance_cap and format their labels
+    void updateDistances();
+
+    //! Whether screen point is close enough to viewport for a label there to be visible
+    [[nodiscard]] bool labelVisible(glm::vec2 screen_pos) const;
+
 public:
     [[nodiscard]] const USV::CaseData *case_data() const {
         return case_data_.get();
@@ -0,0 +1,86 @@
+#include "LogWindow.h"
+#include <nanogui/button.h>
+#include <nanogui/label.h>
+#include <nanogui/layout.h>
+#include <nanogui/textarea.h>
+#include <nanogui/vscrollpanel.h>
+
+namespace {
+    // Older output is dropped beyond this, TextArea keeps every line as a separate block
+    constexpr size_t max_lines = 5000;
+}
+
+LogWindow::LogWindow(Widget* parent, const std::string& title) : Window(parent, title) {
+    using namespace nanogui;
+    set_layout(new BoxLayout(Orientation::Vertical, Alignment::Fill, 5, 5));
+
+    scroll = new VScrollPanel(this);
+    scroll->set_fixed_size({500, 300});
+    text = new TextArea(scroll);
+    text->set_padding(4);
+
+    auto* bottom = new Widget(this);
+    bottom->set_layout(new BoxLayout(Orientation::Horizontal, Alignment::Middle, 0, 10));
+    cancel_button = new Button(bottom, "Cancel");
+    cancel_button->set_icon(FA_STOP);
+    cancel_button->set_enabled(false);
+    status = new Label(bottom, "");
+}
+
+void LogWindow::clear() {
+    text->clear();
+    partial_lines[0].clear();
+    partial_lines[1].clear();
+    lines_count = 0;
+}
+
+void LogWindow::append(USV::USVRunner::Stream stream, const std::string& chunk) {
+    auto& partial = partial_lines[static_cast<size_t>(stream)];
+    size_t begin = 0;
+    for (size_t end; (end = chunk.find('\n', begin)) != std::string::npos; begin = end + 1) {
+        partial.append(chunk, begin, end - begin);
+        appendLine(stream, partial);
+        partial.clear();
+    }
+    partial.append(chunk, begin, std::string::npos);
+    scroll->set_scroll(1.0f);
+}
+
+void LogWindow::flush() {
+    for (auto stream: {USV::USVRunner::Stream::Out, USV::USVRunner::Stream::Err}) {
+        auto& partial = partial_lines[static_cast<size_t>(stream)];
+        if (!partial.empty()) appendLine(stream, partial);
+        partial.clear();
+    }
+    scroll->set_scroll(1.0f);
+}
+
+void LogWindow::appendLine(USV::USVRunner::Stream stream, const std::string& line) {
+    if (lines_count >= max_lines) {
+        text->clear();
+        lines_count = 0;
+        text->set_foreground_color({0.6f, 0.6f, 0.6f, 1.0f});
+        text->append_line("... earlier output dropped");
+    }
+    if (stream == USV::USVRunner::Stream::Err)
+        text->set_foreground_color({1.0f, 0.45f, 0.35f, 1.0f});
+    else
+        text->set_foreground_color({0.9f, 0.9f, 0.9f, 1.0f});
+    // Carriage returns of progress indicators would be drawn as garbage
+    std::string clean(line);
+    if (!clean.empty() && clean.back() == '\r') clean.pop_back();
+    text->append_line(clean);
+    ++lines_count;
+}
+
+void LogWindow::setStatus(const std::string& caption) {
+    status->set_caption(caption);
+}
+
+void LogWindow::setRunning(bool running) {
+    cancel_button->set_enabled(running);
+}
+
+void LogWindow::setCancelCallback(std::function<void()> callback) {
+    cancel_button->set_callback(std::move(callback));
+}
@@ -0,0 +1,49 @@
+#ifndef USV_GUI_LOGWINDOW_H
+#define USV_GUI_LOGWINDOW_H
+
+#include "../usvdata/UsvRun.h"
+#include <nanogui/window.h>
+#include <functional>
+#include <string>
+
+namespace nanogui {
+    class Button;
+    class Label;
+    class TextArea;
+    class VScrollPanel;
+}
+
+/**
+ * \brief Solver output panel: streamed stdout/stderr, run status and cancel button
+ */
+class LogWindow : public nanogui::Window {
+    nanogui::VScrollPanel* scroll;
+    nanogui::TextArea* text;
+    nanogui::Label* status;
+    nanogui::Button* cancel_button;
+    std::string partial_lines[2]; //! Unterminated tail of stdout and stderr
+    size_t lines_count{0};
+public:
+    explicit LogWindow(Widget* parent, const std::string& title = "Solver");
+
+    void clear();
+
+    /**
+     * \brief Appends chunk of output, lines are shown once complete
+     */
+    void append(USV::USVRunner::Stream stream, const std::string& chunk);
+
+    //! Shows unterminated lines
+    void flush();
+
+    void setStatus(const std::string& caption);
+
+    void setRunning(bool running);
+
+    void setCancelCallback(std::function<void()> callback);
+
+private:
+    void appendLine(USV::USVRunner::Stream stream, const std::string& line);
+};
+
+#endif //USV_GUI_LOGWINDOW_H
@@ -0,0 +1,180 @@
+#include "BatchRun.h"
+#include "InputUtils.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace USV::BatchRun {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        std::atomic<bool> interrupted{false};
+
+        void on_interrupt(int) {
+            interrupted = true;
+        }
+
+        struct CaseRun {
+            std::filesystem::path directory;
+            bool skipped{true};
+            USVRunner::Result result{};
+        };
+
+        const char* status(const CaseRun& run) {
+            if (run.skipped) return "skipped";
+            if (!run.result.error.empty()) return "error";
+            if (run.result.cancelled) return "cancelled";
+            if (run.result.timed_out) return "timeout";
+            return run.result.exit_code == 0 ? "ok" : "failed";
+        }
+
+        std::string json_string(const std::string& s) {
+            std::ostringstream os;
+            os << '"';
+            for (const char c: s) {
+                if (c == '"' || c == '\\')
+                    os << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else
+                    os << c;
+            }
+            os << '"';
+            return os.str();
+        }
+
+        std::string relative_name(const std::filesystem::path& directory, const std::filesystem::path& root) {
+            auto relative = directory.lexically_relative(root).generic_string();
+            return relative.empty() ? "." : relative;
+        }
+
+        void write_summary(const std::filesystem::path& filename, const Options& options, size_t jobs,
+                           double wall_time, const std::vector<CaseRun>& runs) {
+            std::ofstream os(filename);
+            if (!os.good()) throw std::runtime_error("Failed to write " + filename.string());
+            os << "{\n  \"root\": " << json_string(options.root.string())
+               << ",\n  \"executable\": " << json_string(options.executable.string())
+               << ",\n  \"jobs\": " << jobs
+               << ",\n  \"timeout_s\": " << options.timeout
+               << ",\n  \"wall_time_s\": " << wall_time
+               << ",\n  \"cases\": [";
+            for (size_t i = 0; i < runs.size(); ++i) {
+                const auto& run = runs[i];
+                os << (i ? "," : "") << "\n    {\"case\": " << json_string(relative_name(run.directory, options.root))
+                   << ", \"status\": \"" << status(run) << "\", \"exit_code\": " << run.result.exit_code
+                   << ", \"wall_time_s\": " << run.result.wall_time
+                   << ", \"peak_rss_kib\": " << run.result.peak_rss_kib
+                   << ", \"cached\": " << (run.result.cached ? "true" : "false");
+                if (!run.result.error.empty()) os << ", \"error\": " << json_string(run.result.error);
+                os << "}";
+            }
+            os << "\n  ]\n}\n";
+            if (!os.good()) throw std::runtime_error("Failed to write " + filename.string());
+        }
+    }
+
+    std::vector<std::filesystem::path> findCases(const std::filesystem::path& root) {
+        std::vector<std::filesystem::path> cases;
+        if (InputUtils::isCaseDirectory(root)) {
+            cases.push_back(root);
+            return cases;
+        }
+        namespace fs = std::filesystem;
+        for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied);
+             it != fs::recursive_directory_iterator(); ++it) {
+            std::error_code ec;
+            if (!it->is_directory(ec) || !InputUtils::isCaseDirectory(it->path())) continue;
+            cases.push_back(it->path());
+            it.disable_recursion_pending();
+        }
+        std::sort(cases.begin(), cases.end());
+        return cases;
+    }
+
+    int run(const Options& options) {
+        const auto cases = findCases(options.root);
+        if (cases.empty()) throw std::runtime_error("No cases found in " + options.root.string());
+        const size_t jobs = std::max<size_t>(1, std::min(options.jobs ? options.jobs : Parallel::threadCount(),
+                                                         cases.size()));
+        std::cout << "Running " << options.executable.string() << " on " << cases.size() << " cases, " << jobs
+                  << " at once" << std::endl;
+
+        std::vector<CaseRun> runs(cases.size());
+        std::mutex mutex;
+        std::condition_variable watcher_wakeup;
+        std::set<USVRunner*> active;
+        size_t finished = 0;
+        bool done = false;
+
+        interrupted = false;
+        const auto previous_handler = std::signal(SIGINT, on_interrupt);
+        // Solvers run in their own process groups and don't get terminal's SIGINT, cancel them from here
+        std::thread watcher([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!done) {
+                watcher_wakeup.wait_for(lock, std::chrono::milliseconds(100));
+                if (interrupted)
+                    for (auto* runner: active) runner->cancel();
+            }
+        });
+
+        const auto start = Clock::now();
+        Parallel::parallelFor(cases.size(), [&](size_t i) {
+            auto& run = runs[i];
+            run.directory = cases[i];
+            if (interrupted) return;
+
+            USVRunner runner(options.executable);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active.insert(&runner);
+            }
+            std::ofstream log(run.directory / log_filename, std::ios::binary);
+            run.result = runner.run(run.directory, &InputUtils::dataFilenames(run.directory),
+                                    [&log](USVRunner::Stream, const std::string& chunk) { log << chunk; },
+                                    options.timeout);
+            run.skipped = false;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            active.erase(&runner);
+            std::cout << '[' << ++finished << '/' << cases.size() << "] " << relative_name(run.directory, options.root)
+                      << ": " << status(run);
+            if (run.result.cached)
+                std::cout << " (cached)";
+            else if (run.result.exit_code >= 0)
+                std::cout << " (" << run.result.exit_code << ")";
+            std::cout << ", " << run.result.wall_time << " s, " << run.result.peak_rss_kib << " KiB" << std::endl;
+        }, 1, jobs);
+        const double wall_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        watcher_wakeup.notify_one();
+        watcher.join();
+        std::signal(SIGINT, previous_handler == SIG_ERR ? SIG_DFL : previous_handler);
+
+        const auto summary = options.summary.empty() ? options.root / summary_filename : options.summary;
+        write_summary(summary, options, jobs, wall_time, runs);
+
+        const auto succeeded = static_cast<size_t>(std::count_if(runs.begin(), runs.end(), [](const CaseRun& run) {
+            return std::string(status(run)) == "ok";
+        }));
+        std::cout << succeeded << '/' << runs.size() << " cases succeeded in " << wall_time << " s, summary: "
+                  << summary.string() << std::endl;
+        return succeeded == runs.size() ? 0 : 1;
+    }
+}
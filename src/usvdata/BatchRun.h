@@ -0,0 +1,40 @@
+#ifndef USV_BATCHRUN_H
+#define USV_BATCHRUN_H
+
+#include "UsvRun.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace USV::BatchRun {
+    //! Solver output of each case is written to this file in case directory
+    constexpr const char* log_filename = "usv-run.log";
+    //! Summary file name in root directory, if no other given
+    constexpr const char* summary_filename = "batch-summary.json";
+
+    struct Options {
+        std::filesystem::path root;
+        std::filesystem::path executable;
+        size_t jobs{0}; //! Concurrent solver runs, 0 means Parallel::threadCount()
+        double timeout{0}; //! Per case timeout [sec], 0 for no timeout
+        std::filesystem::path summary{}; //! Empty means summary_filename in root
+    };
+
+    /**
+     * \brief Case directories under root (root included), sorted. Case directories
+     *        are detected as in InputUtils::loadInputData and not descended into.
+     */
+    std::vector<std::filesystem::path> findCases(const std::filesystem::path& root);
+
+    /**
+     * \brief      Runs solver on every case under root, up to options.jobs at once.
+     *
+     * Prints a line per finished case and writes JSON summary with exit code, wall time and
+     * peak memory of each run. SIGINT cancels running solvers and skips the remaining cases.
+     * @return 0 if every solver run exited with 0, 1 otherwise
+     * @throws std::runtime_error if root can't be listed or summary can't be written
+     */
+    int run(const Options& options);
+}
+
+#endif //USV_BATCHRUN_H
@@ -0,0 +1,41 @@
+#include "CacheDirectory.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+#include <process.h>
+#define USV_GETPID _getpid
+#else
+#include <unistd.h>
+#define USV_GETPID getpid
+#endif
+
+namespace USV {
+    namespace fs = std::filesystem;
+
+    fs::path cacheDirectory(const char* environment_variable, const char* name) {
+        if (const char* env = std::getenv(environment_variable)) {
+            const std::string value(env);
+            if (value.empty() || value == "off") return {};
+            return value;
+        }
+#ifdef _WIN32
+        if (const char* local = std::getenv("LOCALAPPDATA")) return fs::path(local) / "usv-gui" / name;
+#else
+        if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+            return fs::path(xdg) / "usv-gui" / name;
+        if (const char* home = std::getenv("HOME")) return fs::path(home) / ".cache" / "usv-gui" / name;
+#endif
+        return {};
+    }
+
+    fs::path temporaryPath(const fs::path& path) {
+        static std::atomic<uint64_t> counter{0};
+        auto tmp = path;
+        tmp += ".tmp-" + std::to_string(USV_GETPID()) + "-" + std::to_string(counter++);
+        return tmp;
+    }
+}
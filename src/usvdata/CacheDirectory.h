@@ -0,0 +1,21 @@
+#ifndef USV_CACHEDIRECTORY_H
+#define USV_CACHEDIRECTORY_H
+
+#include <filesystem>
+
+namespace USV {
+    /**
+     * \brief Location of a usv-gui cache: environment_variable if set, else usv-gui/name in user cache
+     *        directory (XDG_CACHE_HOME or ~/.cache, LOCALAPPDATA on Windows). Empty if cache is
+     *        disabled (variable set to "off" or empty).
+     */
+    std::filesystem::path cacheDirectory(const char* environment_variable, const char* name);
+
+    /**
+     * \brief Name next to path to write its new contents to before renaming it into place. Unique
+     *        among threads and processes, so concurrent writers never share a temporary file.
+     */
+    std::filesystem::path temporaryPath(const std::filesystem::path& path);
+}
+
+#endif //USV_CACHEDIRECTORY_H
@@ -0,0 +1,514 @@
+#include "CaseCache.h"
+#include "CacheDirectory.h"
+#include "Hash.h"
+#include "InputUtils.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace USV::CaseCache {
+    namespace {
+        // Bump on any change of the layout below or of the conversions results
+        constexpr uint32_t cache_version = 1;
+        constexpr char cache_magic[8] = {'U', 'S', 'V', 'C', 'A', 'C', 'H', 'E'};
+        constexpr uint32_t byte_order_mark = 0x01020304;
+
+        enum class SectionId : uint32_t {
+            Paths = 1,
+            Restrictions = 2
+        };
+
+        struct SectionEntry {
+            SectionId id;
+            uint32_t reserved;
+            uint64_t key;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t byte_order;
+            uint32_t version;
+            uint32_t sections_count;
+            uint32_t reserved;
+        };
+
+        class Writer {
+        public:
+            std::vector<char> data;
+
+            template<typename T>
+            void put(const T& value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                const auto* p = reinterpret_cast<const char*>(&value);
+                data.insert(data.end(), p, p + sizeof(T));
+            }
+
+            template<typename T>
+            void putArray(const std::vector<T>& values) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                put(static_cast<uint64_t>(values.size()));
+                const auto* p = reinterpret_cast<const char*>(values.data());
+                data.insert(data.end(), p, p + values.size() * sizeof(T));
+            }
+
+            void put(const std::string& s) {
+                put(static_cast<uint64_t>(s.size()));
+                data.insert(data.end(), s.begin(), s.end());
+            }
+
+            void put(const Vector2& v) {
+                put(v.x());
+                put(v.y());
+            }
+
+            void put(const std::vector<Vector2>& points) {
+                put(static_cast<uint64_t>(points.size()));
+                for (const auto& p: points) put(p);
+            }
+        };
+
+        /**
+         * Bounds checked reading, throws std::runtime_error on truncated data
+         */
+        class Reader {
+            const char* p;
+            const char* end;
+
+            void need(uint64_t count, size_t item_size = 1) const {
+                if (count > remaining() / item_size) throw std::runtime_error("Truncated case cache");
+            }
+
+        public:
+            Reader(const char* data, size_t size) : p(data), end(data + size) {}
+
+            [[nodiscard]] size_t remaining() const { return static_cast<size_t>(end - p); }
+
+            //! Reads count of following items, each taking at least min_item_size bytes
+            uint64_t getCount(size_t min_item_size) {
+                const auto count = get<uint64_t>();
+                need(count, min_item_size);
+                return count;
+            }
+
+            template<typename T>
+            T get() {
+                static_assert(std::is_trivially_copyable_v<T>);
+                need(sizeof(T));
+                T value;
+                std::memcpy(&value, p, sizeof(T));
+                p += sizeof(T);
+                return value;
+            }
+
+            template<typename T>
+            std::vector<T> getArray() {
+                const auto count = getCount(sizeof(T));
+                std::vector<T> values(count);
+                std::memcpy(values.data(), p, count * sizeof(T));
+                p += count * sizeof(T);
+                return values;
+            }
+
+            std::string getString() {
+                const auto size = getCount(1);
+                std::string s(p, size);
+                p += size;
+                return s;
+            }
+
+            Vector2 getVector2() {
+                const auto x = get<double>();
+                return {x, get<double>()};
+            }
+
+            std::vector<Vector2> getPoints() {
+                const auto count = getCount(2 * sizeof(double));
+                std::vector<Vector2> points;
+                points.reserve(count);
+                for (uint64_t i = 0; i < count; ++i) points.push_back(getVector2());
+                return points;
+            }
+        };
+
+        constexpr uint32_t own_ship_index = std::numeric_limits<uint32_t>::max();
+        constexpr uint32_t no_properties = std::numeric_limits<uint32_t>::max();
+
+        //! Hash of files contents, missing files hash differently from empty ones
+        uint64_t filesKey(const std::filesystem::path& directory, std::initializer_list<std::string_view> filenames) {
+            uint64_t key = fnv1a_offset_basis;
+            key = fnv1a(&cache_version, sizeof(cache_version), key);
+            for (const auto& filename: filenames) {
+                key = fnv1a(filename, key);
+                const auto path = directory / filename;
+                std::error_code ec;
+                if (!std::filesystem::is_regular_file(path, ec)) {
+                    key = fnv1a(std::string_view("<missing>"), key);
+                    continue;
+                }
+                MappedFile file(path);
+                const auto size = static_cast<uint64_t>(file.size());
+                key = fnv1a(&size, sizeof(size), key);
+                key = fnv1a(file.data(), file.size(), key);
+            }
+            return key;
+        }
+
+        struct CachedPath {
+            PathType type;
+            uint32_t ship;
+            Path path;
+        };
+
+        // Paths
+
+        void writePaths(Writer& w, const CaseData& case_data) {
+            w.put(static_cast<uint64_t>(case_data.paths.size()));
+            for (const auto& pe: case_data.paths) {
+                w.put(static_cast<uint32_t>(pe.pathType));
+                w.put(pe.ship == &case_data.ownShip ? own_ship_index
+                                                    : static_cast<uint32_t>(static_cast<const Target*>(pe.ship) -
+                                                                            case_data.targets.data()));
+                w.put(pe.path.getStartTime());
+                w.put(static_cast<uint64_t>(pe.path.size()));
+                for (const auto& s: pe.path.getSegments()) {
+                    const auto& segment = s.second;
+                    w.put(segment.getStartPoint());
+                    w.put(segment.getBeginAngle().radians());
+                    w.put(segment.getCurve());
+                    w.put(segment.getLength());
+                    w.put(segment.getDuration());
+                    w.put(segment.getPortDev());
+                    w.put(segment.getStarboardDev());
+                }
+            }
+        }
+
+        std::vector<CachedPath> readPaths(Reader& r) {
+            std::vector<CachedPath> paths(r.getCount(1), {PathType::Route, 0, Path(0.0)});
+            for (auto& cached: paths) {
+                const auto type = r.get<uint32_t>();
+                if (type >= static_cast<uint32_t>(PathType::End)) throw std::runtime_error("Corrupt case cache");
+                cached.type = static_cast<PathType>(type);
+                cached.ship = r.get<uint32_t>();
+                cached.path = Path(r.get<double>());
+                const auto segments_count = r.getCount(8 * sizeof(double));
+                for (uint64_t i = 0; i < segments_count; ++i) {
+                    const auto start_point = r.getVector2();
+                    const auto begin_angle = r.get<double>();
+                    const auto curve = r.get<double>();
+                    const auto length = r.get<double>();
+                    const auto duration = r.get<double>();
+                    const auto port_dev = r.get<double>();
+                    const auto starboard_dev = r.get<double>();
+                    cached.path.appendSegment({start_point, begin_angle, curve, length, duration, port_dev,
+                                               starboard_dev});
+                }
+            }
+            return paths;
+        }
+
+        // Restrictions
+
+        void writePolygon(Writer& w, const Restrictions::Polygon& polygon) {
+            w.put(static_cast<uint64_t>(polygon.rings.size()));
+            for (const auto& ring: polygon.rings) w.put(ring);
+            w.putArray(polygon.triangles);
+        }
+
+        Restrictions::Polygon readPolygon(Reader& r) {
+            Restrictions::Polygon polygon;
+            polygon.rings.resize(r.getCount(sizeof(uint64_t)));
+            for (auto& ring: polygon.rings) ring = r.getPoints();
+            if (polygon.rings.empty()) throw std::runtime_error("Corrupt case cache");
+            polygon.triangles = r.getArray<uint32_t>();
+            polygon.buildEdgeTables();
+            return polygon;
+        }
+
+        void writeRestrictions(Writer& w, const Restrictions::Restrictions& restrictions) {
+            std::unordered_map<const FeatureProperties*, uint32_t> properties_index;
+            w.put(static_cast<uint64_t>(restrictions.properties.size()));
+            for (const auto& p: restrictions.properties) {
+                properties_index.emplace(&p, static_cast<uint32_t>(properties_index.size()));
+                w.put(p.id);
+                w.put(static_cast<uint32_t>(p.limitation_type));
+                w.put(static_cast<uint32_t>(p.hardness));
+                w.put(p.source_id);
+                w.put(p.source_object_code);
+                w.put(p.distance);
+                w.put(p.max_course);
+                w.put(p.min_course);
+                w.put(p.max_speed);
+            }
+            auto index_of = [&](const FeatureProperties* p) {
+                const auto itr = properties_index.find(p);
+                return itr == properties_index.end() ? no_properties : itr->second;
+            };
+
+            for (const auto* l: {&restrictions.hard, &restrictions.soft}) {
+                w.put(static_cast<uint64_t>(l->PointApproachProhibitions().size()));
+                for (const auto& item: l->PointApproachProhibitions()) {
+                    w.put(index_of(item._ptr));
+                    w.put(item.point);
+                }
+                w.put(static_cast<uint64_t>(l->LineCrossingProhibitions().size()));
+                for (const auto& item: l->LineCrossingProhibitions()) {
+                    w.put(index_of(item._ptr));
+                    w.put(item.linestring);
+                }
+                w.put(static_cast<uint64_t>(l->ZoneEnteringProhibitions().size()));
+                for (const auto& item: l->ZoneEnteringProhibitions()) {
+                    w.put(index_of(item._ptr));
+                    writePolygon(w, item.polygon);
+                }
+                w.put(static_cast<uint64_t>(l->ZoneLeavingProhibitions().size()));
+                for (const auto& item: l->ZoneLeavingProhibitions()) {
+                    w.put(index_of(item._ptr));
+                    writePolygon(w, item.polygon);
+                }
+                w.put(static_cast<uint64_t>(l->MovementParametersLimitations().size()));
+                for (const auto& item: l->MovementParametersLimitations()) {
+                    w.put(index_of(item._ptr));
+                    writePolygon(w, item.polygon);
+                }
+            }
+        }
+
+        Restrictions::Restrictions readRestrictions(Reader& r) {
+            Restrictions::Restrictions restrictions;
+            const auto properties_count = r.getCount(1);
+            for (uint64_t i = 0; i < properties_count; ++i) {
+                FeatureProperties p;
+                p.id = r.getString();
+                p.limitation_type = static_cast<LimitationType>(r.get<uint32_t>());
+                p.hardness = static_cast<RestrictionType>(r.get<uint32_t>());
+                p.source_id = r.getString();
+                p.source_object_code = r.getString();
+                p.distance = r.get<double>();
+                p.max_course = r.get<double>();
+                p.min_course = r.get<double>();
+                p.max_speed = r.get<double>();
+                restrictions.properties.push_back(std::move(p));
+            }
+            auto properties = [&](uint32_t index) -> FeatureProperties* {
+                if (index == no_properties) return nullptr;
+                if (index >= restrictions.properties.size()) throw std::runtime_error("Corrupt case cache");
+                return &restrictions.properties[index];
+            };
+
+            // Same order as written, add_* keep items already filtered on writing
+            for (auto* l: {&restrictions.hard, &restrictions.soft}) {
+                for (auto count = r.get<uint64_t>(); count > 0; --count) {
+                    auto* p = properties(r.get<uint32_t>());
+                    l->add_point_approach_prohibition(r.getVector2(), p);
+                }
+                for (auto count = r.get<uint64_t>(); count > 0; --count) {
+                    auto* p = properties(r.get<uint32_t>());
+                    auto line = r.getPoints();
+                    l->add_line_crossing_prohibition(std::move(line), p);
+                }
+                for (auto count = r.get<uint64_t>(); count > 0; --count) {
+                    auto* p = properties(r.get<uint32_t>());
+                    auto polygon = readPolygon(r);
+                    l->add_zone_entering_prohibition(std::move(polygon), p);
+                }
+                for (auto count = r.get<uint64_t>(); count > 0; --count) {
+                    auto* p = properties(r.get<uint32_t>());
+                    auto polygon = readPolygon(r);
+                    l->add_zone_leaving_prohibition(std::move(polygon), p);
+                }
+                for (auto count = r.get<uint64_t>(); count > 0; --count) {
+                    auto* p = properties(r.get<uint32_t>());
+                    auto polygon = readPolygon(r);
+                    l->add_movement_parameters_limitation(std::move(polygon), p);
+                }
+            }
+            restrictions.buildIndex();
+            return restrictions;
+        }
+
+        /**
+         * Sections of cache file with matching keys, nothing if there is no usable cache
+         */
+        struct CacheContents {
+            std::optional<std::vector<CachedPath>> paths;
+            std::optional<Restrictions::Restrictions> restrictions;
+        };
+
+        CacheContents readCache(const std::filesystem::path& filename, uint64_t paths_key, uint64_t restrictions_key) {
+            CacheContents contents;
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(filename, ec)) return contents;
+            try {
+                MappedFile file(filename);
+                Reader r(file.data(), file.size());
+                const auto header = r.get<Header>();
+                if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+                    header.byte_order != byte_order_mark || header.version != cache_version)
+                    return contents;
+                for (uint32_t i = 0; i < header.sections_count; ++i) {
+                    const auto entry = r.get<SectionEntry>();
+                    if (entry.offset > file.size() || entry.size > file.size() - entry.offset)
+                        throw std::runtime_error("Truncated case cache");
+                    Reader section(file.data() + entry.offset, static_cast<size_t>(entry.size));
+                    if (entry.id == SectionId::Paths && entry.key == paths_key)
+                        contents.paths = readPaths(section);
+                    else if (entry.id == SectionId::Restrictions && entry.key == restrictions_key)
+                        contents.restrictions = readRestrictions(section);
+                }
+            } catch (const std::exception& e) {
+                std::cout << "Ignoring case cache `" << filename.string() << "`: " << e.what() << std::endl;
+                return {};
+            }
+            return contents;
+        }
+
+        void writeCache(const std::filesystem::path& filename, const CaseData& case_data,
+                        uint64_t paths_key, uint64_t restrictions_key) {
+            Writer paths, restrictions;
+            writePaths(paths, case_data);
+            writeRestrictions(restrictions, case_data.restrictions);
+
+            Header header{};
+            std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+            header.byte_order = byte_order_mark;
+            header.version = cache_version;
+            header.sections_count = 2;
+            uint64_t offset = sizeof(Header) + 2 * sizeof(SectionEntry);
+            const SectionEntry entries[2] = {
+                    {SectionId::Paths, 0, paths_key, offset, paths.data.size()},
+                    {SectionId::Restrictions, 0, restrictions_key, offset + paths.data.size(),
+                     restrictions.data.size()}
+            };
+
+            // Write aside and rename, so readers never see partially written cache
+            const auto tmp_filename = temporaryPath(filename);
+            {
+                std::ofstream ofs(tmp_filename, std::ios::binary | std::ios::trunc);
+                if (!ofs.good()) throw std::runtime_error("Failed to open " + tmp_filename.string());
+                ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                ofs.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+                ofs.write(paths.data.data(), static_cast<std::streamsize>(paths.data.size()));
+                ofs.write(restrictions.data.data(), static_cast<std::streamsize>(restrictions.data.size()));
+                if (!ofs.good()) {
+                    ofs.close();
+                    std::error_code ec;
+                    std::filesystem::remove(tmp_filename, ec);
+                    throw std::runtime_error("Failed to write " + tmp_filename.string());
+                }
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmp_filename, filename, ec);
+            if (ec) {
+                std::filesystem::remove(tmp_filename, ec);
+                throw std::runtime_error("Failed to write " + filename.string());
+            }
+        }
+    }
+
+    std::unique_ptr<CaseData> loadCase(const std::string& data_directory, bool use_cache) {
+        if (!use_cache) return std::make_unique<CaseData>(InputUtils::loadInputData(data_directory));
+
+        const std::filesystem::path directory(data_directory);
+        const auto& f = InputUtils::dataFilenames(directory);
+        // Navigation parameters define the local frame, targets decide which targets paths are used
+        const auto paths_key = filesKey(directory, {f.navigationParameters, f.navigationProblem, f.route, f.maneuvers,
+                                                    f.targets_paths, InputUtils::wasted_maneuvers_filename});
+        const auto restrictions_key = filesKey(directory, {f.navigationParameters, f.constraints});
+        const auto cache_path = directory / cache_filename;
+
+        auto cached = readCache(cache_path, paths_key, restrictions_key);
+        auto case_data = std::make_unique<CaseData>(
+                InputUtils::loadInputData(data_directory, !cached.paths, !cached.restrictions));
+        if (cached.paths) {
+            case_data->paths.reserve(cached.paths->size());
+            for (auto& c: *cached.paths) {
+                if (c.ship != own_ship_index && c.ship >= case_data->targets.size())
+                    return loadCase(data_directory, false);
+                const Ship* ship = c.ship == own_ship_index ? static_cast<const Ship*>(&case_data->ownShip)
+                                                            : &case_data->targets[c.ship];
+                case_data->paths.emplace_back(c.type, ship, std::move(c.path));
+            }
+            case_data->updateTimeRange();
+        }
+        if (cached.restrictions) {
+            case_data->restrictions = std::move(*cached.restrictions);
+        }
+
+        if (!cached.paths || !cached.restrictions) {
+            try {
+                writeCache(cache_path, *case_data, paths_key, restrictions_key);
+            } catch (const std::exception& e) {
+                // Read-only case directories are fine, the case just isn't cached
+                std::cout << "Couldn't write case cache: " << e.what() << std::endl;
+            }
+        }
+        return case_data;
+    }
+
+    CaseChanges changesOf(const CaseData& case_data, const std::vector<std::string>& changed_filenames) {
+        CaseChanges changes;
+        const auto& f = *case_data.data_filenames;
+        auto add_paths = [&changes](PathType type) {
+            if (std::find(changes.paths.begin(), changes.paths.end(), type) == changes.paths.end())
+                changes.paths.push_back(type);
+        };
+        for (const auto& name: changed_filenames) {
+            std::string_view filename;
+            if (name == f.navigationParameters || name == f.navigationProblem || name == f.settings) {
+                // Frame, ships and radius depend on these
+                changes.reload = true;
+                filename = name == f.settings ? f.settings : name == f.navigationProblem ? f.navigationProblem
+                                                                                       : f.navigationParameters;
+            } else if (name == f.constraints) {
+                changes.restrictions = true;
+                filename = f.constraints;
+            } else if (name == f.analyse) {
+                changes.analyse = true;
+                filename = f.analyse;
+            } else if (name == f.maneuvers) {
+                add_paths(PathType::ShipManeuver);
+                filename = f.maneuvers;
+            } else if (name == f.route) {
+                add_paths(PathType::Route);
+                filename = f.route;
+            } else if (name == f.targets_paths) {
+                add_paths(PathType::TargetManeuver);
+                filename = f.targets_paths;
+            } else if (name == InputUtils::wasted_maneuvers_filename) {
+                add_paths(PathType::WastedManeuver);
+                filename = InputUtils::wasted_maneuvers_filename;
+            } else {
+                continue;
+            }
+            if (std::find(changes.filenames.begin(), changes.filenames.end(), filename) == changes.filenames.end())
+                changes.filenames.push_back(filename);
+        }
+        return changes;
+    }
+
+    void reloadChanged(CaseData& case_data, const CaseChanges& changes) {
+        if (changes.reload) throw std::runtime_error("Case has to be loaded again");
+        if (changes.empty()) return;
+        // Everything is parsed and converted before the case is touched
+        const auto input_data = InputUtils::loadInputFiles(case_data.directory.string(), changes.filenames);
+        std::optional<Restrictions::Restrictions> restrictions;
+        if (changes.restrictions && input_data.constraints)
+            restrictions.emplace(*input_data.constraints, case_data.frame);
+
+        if (!changes.paths.empty()) case_data.replacePaths(input_data, changes.paths);
+        if (changes.restrictions) case_data.restrictions = restrictions ? std::move(*restrictions)
+                                                                        : Restrictions::Restrictions();
+        if (changes.analyse) case_data.setAnalyseResult(input_data.analyse_result);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef USV_CASECACHE_H
+#define USV_CASECACHE_H
+
+#include "CaseData.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace USV::CaseCache {
+    //! Cache file name, stored in case directory
+    constexpr const char* cache_filename = ".usv-gui-cache";
+
+    /**
+     * \brief      Loads case from data_directory using binary cache stored next to it.
+     *
+     * Cache holds converted paths (keyed by hashes of navigation, targets and paths files)
+     * and converted restrictions with triangulations (keyed by hashes of navigation and
+     * constraints files). Sections with matching keys are read from the mapped cache
+     * instead of parsing and converting JSON, the cache is rewritten if any section missed.
+     * Unreadable or outdated cache is ignored.
+     * @param use_cache If false, loads as InputUtils::loadInputData and leaves cache untouched
+     * @throws std::runtime_error if case can't be loaded
+     */
+    std::unique_ptr<CaseData> loadCase(const std::string& data_directory, bool use_cache = true);
+
+    //! Parts of a loaded case affected by changed files
+    struct CaseChanges {
+        bool reload{false}; //! Frame, ships or settings changed, case has to be loaded again
+        bool restrictions{false};
+        bool analyse{false};
+        std::vector<PathType> paths{};
+        std::vector<std::string_view> filenames{}; //! Changed files of case, as in DataFilenames
+
+        [[nodiscard]] inline bool empty() const {
+            return !reload && !restrictions && !analyse && paths.empty();
+        }
+    };
+
+    /**
+     * \brief Classifies changed files of case directory. Files the case doesn't read are ignored.
+     * @param changed_filenames Names relative to case directory
+     */
+    CaseChanges changesOf(const CaseData& case_data, const std::vector<std::string>& changed_filenames);
+
+    /**
+     * \brief Parses only changed files and updates case in place: paths of changed types,
+     *        restrictions or target statuses. Targets and other paths stay as they are.
+     * @throws std::runtime_error if changed files can't be loaded, case is left unchanged then
+     */
+    void reloadChanged(CaseData& case_data, const CaseChanges& changes);
+}
+
+#endif //USV_CASECACHE_H
@@ -1,11 +1,89 @@
 #include "CaseData.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iterator>
 
 namespace USV {
+    namespace {
+        constexpr PathType all_path_types[] = {PathType::TargetManeuver, PathType::WastedManeuver,
+                                               PathType::ShipManeuver, PathType::Route};
+
+        struct PathJob {
+            PathType type;
+            const Ship* ship;
+            const CurvedPath* curved_path;
+        };
+
+        /**
+         * Paths of given types found in input_data, in display order: own maneuvers, route,
+         * wasted maneuvers, targets maneuvers
+         */
+        template<typename Types>
+        std::vector<PathJob> path_jobs(const InputTypes::InputData& input_data, const OwnShip& own_ship,
+                                       const std::vector<Target>& targets, const Types& types) {
+            auto wanted = [&types](PathType type) {
+                return std::find(std::begin(types), std::end(types), type) != std::end(types);
+            };
+            std::vector<PathJob> jobs;
+            if (input_data.maneuvers && wanted(PathType::ShipManeuver))
+                for (const auto& path:*input_data.maneuvers)
+                    jobs.push_back({PathType::ShipManeuver, &own_ship, &path.path});
+
+            if (input_data.route && wanted(PathType::Route))
+                jobs.push_back({PathType::Route, &own_ship, input_data.route.get()});
+
+            if (input_data.wasted_maneuvers && wanted(PathType::WastedManeuver)) {
+                for (const auto& solver_wasted : *input_data.wasted_maneuvers) {
+                    for (const auto& m : solver_wasted) {
+                        jobs.push_back({PathType::WastedManeuver, &own_ship, &m});
+                    }
+                }
+            }
+
+            // Targets paths are used only if there is one for every target
+            if (input_data.targets_paths && input_data.targets_paths->size() == targets.size() &&
+                wanted(PathType::TargetManeuver)) {
+                for (size_t i = 0; i < targets.size(); ++i)
+                    jobs.push_back({PathType::TargetManeuver, &targets[i], &input_data.targets_paths->at(i)});
+            }
+            return jobs;
+        }
+
+        // Paths are independent, convert them in parallel, keeping order
+        std::vector<PathEnvelope> convert_paths(const std::vector<PathJob>& jobs, const Frame& frame) {
+            std::vector<Path> converted(jobs.size(), Path(0.0));
+            Parallel::parallelFor(jobs.size(), [&](size_t i) {
+                converted[i] = Path(*jobs[i].curved_path, frame);
+            });
+            std::vector<PathEnvelope> paths;
+            paths.reserve(jobs.size());
+            for (size_t i = 0; i < jobs.size(); ++i)
+                paths.emplace_back(jobs[i].type, jobs[i].ship, std::move(converted[i]));
+            return paths;
+        }
+    }
+
+    uint64_t PathEnvelope::nextId() {
+        static std::atomic<uint64_t> next_id{1};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
     CaseData::CaseData(const InputTypes::InputData& input_data) :
-            radius(input_data.settings->manuever_calculation.safe_diverg_dist * 0.5), analyse_result(
-            input_data.analyse_result), frame(input_data.navigationParameters->lat,
-                                              input_data.navigationParameters->lon), directory(input_data.directory)
-            , data_filenames(input_data.data_filenames), start_time(input_data.navigationParameters->timestamp) {
+            radius(input_data.settings->manuever_calculation.safe_diverg_dist * 0.5),
+            frame(input_data.navigationParameters->lat, input_data.navigationParameters->lon),
+            directory(input_data.directory), data_filenames(input_data.data_filenames),
+            start_time(input_data.navigationParameters->timestamp) {
+
+        // Restrictions are independent of ships and paths, convert them meanwhile
+        std::future<Restrictions::Restrictions> restrictions_future;
+        if (input_data.constraints) {
+            restrictions_future = std::async(std::launch::async, [&input_data, this] {
+                return Restrictions::Restrictions(*input_data.constraints, frame);
+            });
+        }
 
         // LOAD OWN SHIP
 
@@ -17,71 +95,77 @@ namespace USV {
                            nav_params.timestamp,
                            {{localPos.y(), localPos.x()}, M_PI_2 - degrees_to_radians(nav_params.COG), nav_params.SOG},
                            "Own"}};
-        if (input_data.maneuvers)
-            for (const auto& path:*input_data.maneuvers)
-                paths.emplace_back(PathType::ShipManeuver, &ownShip, Path(path.path, frame));
-
-        paths.emplace_back(PathType::Route, &ownShip, Path(*input_data.route, frame));
 
         // LOAD TARGETS
-        std::map<std::string, const InputTypes::AnalyseResult::TargetStatus*> target_statuses;
-        if (analyse_result != nullptr) {
-            for (const auto& ts: analyse_result->target_statuses)
-                target_statuses.emplace(ts.id, &ts);
-        }
-
-        // check for paths
-        std::vector<CurvedPath>* targets_paths = nullptr;
-        if (input_data.targets_paths && input_data.targets_paths->size() == input_data.navigationProblem->size()) {
-            targets_paths = input_data.targets_paths.get();
-        }
-        if (input_data.targets_real_paths &&
-            input_data.targets_real_paths->size() == input_data.navigationProblem->size()) {
-        }
-
-        if(input_data.wasted_maneuvers){
-            for(const auto& solver_wasted : *input_data.wasted_maneuvers){
-                for(const auto& m : solver_wasted){
-                    paths.emplace_back(PathType::WastedManeuver, &ownShip, Path(m, frame));
-                }
-            }
-        }
-
         const auto& nav_problem = *input_data.navigationProblem;
         targets.reserve(nav_problem.size());
-        for (size_t i = 0; i < nav_problem.size(); ++i) {
-            localPos = frame.fromWgs(nav_problem[i].lat, nav_problem[i].lon);
-            const InputTypes::AnalyseResult::TargetStatus* target_status{};
-            if(analyse_result != nullptr) {
-                auto traget_status_itr = target_statuses.find(nav_problem[i].id);
-                target_status = (traget_status_itr != target_statuses.end() ? traget_status_itr->second : nullptr);
-            }
-
-
+        for (const auto& target: nav_problem) {
+            localPos = frame.fromWgs(target.lat, target.lon);
             targets.push_back({
-                                      {nav_problem[i].cat,
-                                              nav_problem[i].timestamp,
+                                      {target.cat,
+                                              target.timestamp,
                                               {{localPos.y(), localPos.x()},
-                                                      M_PI_2 - degrees_to_radians(nav_problem[i].COG),
-                                                      nav_problem[i].SOG
+                                                      M_PI_2 - degrees_to_radians(target.COG),
+                                                      target.SOG
                                                       },
-                                              nav_problem[i].id,
-                                              target_status
+                                              target.id
                                       }});
+        }
+        setAnalyseResult(input_data.analyse_result);
 
-            if (targets_paths)
-                paths.emplace_back(PathType::TargetManeuver, &targets[i], Path(input_data.targets_paths->at(i), frame));
+        paths = convert_paths(path_jobs(input_data, ownShip, targets, all_path_types), frame);
+        updateTimeRange();
+
+        if (restrictions_future.valid()) {
+            restrictions = restrictions_future.get();
         }
+    }
 
-        for (const auto& pe: paths) {
-            min_time = std::min(pe.path.getStartTime(), min_time);
-            max_time = std::max(pe.path.endTime(), max_time);
+    void CaseData::replacePaths(const InputTypes::InputData& input_data, const std::vector<PathType>& types) {
+        auto replaced = [&types](PathType type) {
+            return std::find(types.begin(), types.end(), type) != types.end();
+        };
+        auto fresh = convert_paths(path_jobs(input_data, ownShip, targets, types), frame);
+        std::vector<PathEnvelope> merged;
+        merged.reserve(paths.size() + fresh.size());
+        std::vector<PathType> inserted;
+        auto insert_type = [&](PathType type) {
+            inserted.push_back(type);
+            for (auto& pe: fresh)
+                if (pe.pathType == type) merged.push_back(std::move(pe));
+        };
+        for (auto& pe: paths) {
+            if (!replaced(pe.pathType)) {
+                merged.push_back(std::move(pe));
+            } else if (std::find(inserted.begin(), inserted.end(), pe.pathType) == inserted.end()) {
+                insert_type(pe.pathType);
+            }
         }
+        for (auto type: types)
+            if (std::find(inserted.begin(), inserted.end(), type) == inserted.end()) insert_type(type);
+        paths = std::move(merged);
+        updateTimeRange();
+    }
 
-        // END LOAD TARGETS
+    void CaseData::setAnalyseResult(std::shared_ptr<InputTypes::AnalyseResult> result) {
+        analyse_result = std::move(result);
+        std::map<std::string, const InputTypes::AnalyseResult::TargetStatus*> target_statuses;
+        if (analyse_result != nullptr) {
+            for (const auto& ts: analyse_result->target_statuses)
+                target_statuses.emplace(ts.id, &ts);
+        }
+        for (auto& target: targets) {
+            const auto it = target_statuses.find(target.name);
+            target.target_status = it != target_statuses.end() ? it->second : nullptr;
+        }
+    }
 
-        if (input_data.constraints) {
-            restrictions = Restrictions::Restrictions(*input_data.constraints, frame);
+    void CaseData::updateTimeRange() {
+        min_time = std::numeric_limits<double>::infinity();
+        max_time = 0;
+        for (const auto& pe: paths) {
+            min_time = std::min(pe.path.getStartTime(), min_time);
+            max_time = std::max(pe.path.endTime(), max_time);
         }
     }
 }
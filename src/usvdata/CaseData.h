@@ -38,13 +38,17 @@ namespace USV {
         PathType pathType;
         const Ship* ship;
         Path path;
+        //! Unique within process, kept when envelope is moved. Lets renderers keep data uploaded for the path.
+        uint64_t id;
 
         inline PathEnvelope(PathType path_type, const Ship* ship, Path& path) :
-                pathType(path_type), ship(ship), path(path) {}
+                pathType(path_type), ship(ship), path(path), id(nextId()) {}
 
         inline PathEnvelope(PathType path_type, const Ship* ship, Path path) :
-                pathType(path_type), ship(ship), path(std::move(path)) {}
+                pathType(path_type), ship(ship), path(std::move(path)), id(nextId()) {}
 
+    private:
+        static uint64_t nextId();
     };
 
     struct CaseData {
@@ -62,8 +66,28 @@ namespace USV {
 
         std::vector<PathEnvelope> paths;
 
+        /**
+         * \brief Converts loaded case. Paths whose files were not loaded are left out,
+         *        so they can be filled from elsewhere (see CaseCache).
+         */
         explicit CaseData(const InputTypes::InputData& input_data);
 
+        /**
+         * \brief Recomputes min_time and max_time from paths
+         */
+        void updateTimeRange();
+
+        /**
+         * \brief Replaces paths of given types with ones found in input_data, other paths are kept.
+         *        Replaced paths take place of the old ones of their type, new types go last.
+         */
+        void replacePaths(const InputTypes::InputData& input_data, const std::vector<PathType>& types);
+
+        /**
+         * \brief Sets analyse result and links targets to their statuses in it
+         */
+        void setAnalyseResult(std::shared_ptr<InputTypes::AnalyseResult> result);
+
 //        CaseData(const CaseData& o) : frame(o.frame),
 //                max_time(o.max_time),
 //                min_time(o.min_time),
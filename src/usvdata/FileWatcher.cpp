@@ -0,0 +1,141 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace USV {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+    }
+
+#ifdef __linux__
+    FileWatcher::FileWatcher(std::filesystem::path directory, Callback on_change,
+                             std::chrono::milliseconds settle_time)
+            : directory_(std::move(directory)), on_change(std::move(on_change)), settle_time(settle_time) {
+        fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) throw std::runtime_error(std::string("inotify_init1: ") + std::strerror(errno));
+        // Editors save by renaming over the file, solvers write in place
+        if (::inotify_add_watch(fd, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0 ||
+            ::pipe2(stop_pipe, O_CLOEXEC) != 0) {
+            const auto error = std::string("Failed to watch ") + directory_.string() + ": " + std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error(error);
+        }
+        thread = std::thread(&FileWatcher::watch, this);
+    }
+
+    FileWatcher::~FileWatcher() {
+        const char stop = 1;
+        while (::write(stop_pipe[1], &stop, 1) < 0 && errno == EINTR);
+        thread.join();
+        ::close(stop_pipe[0]);
+        ::close(stop_pipe[1]);
+        ::close(fd);
+    }
+
+    void FileWatcher::watch() {
+        std::set<std::string> changed;
+        Clock::time_point last_event{};
+        alignas(inotify_event) char buffer[4096];
+        pollfd fds[2] = {{fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+        while (true) {
+            int timeout = -1;
+            if (!changed.empty()) {
+                const auto quiet = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - last_event);
+                timeout = static_cast<int>(std::max<long long>(0, (settle_time - quiet).count()));
+            }
+            const int ready = ::poll(fds, 2, timeout);
+            if (ready < 0 && errno != EINTR) return;
+            if (fds[1].revents) return;
+            if (ready > 0 && (fds[0].revents & POLLIN)) {
+                ssize_t n;
+                while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + n;) {
+                        const auto* event = reinterpret_cast<const inotify_event*>(p);
+                        if (event->len > 0) changed.emplace(event->name);
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+                last_event = Clock::now();
+            } else if (ready == 0 && !changed.empty()) {
+                on_change(std::vector<std::string>(changed.begin(), changed.end()));
+                changed.clear();
+            }
+        }
+    }
+#else
+    FileWatcher::FileWatcher(std::filesystem::path directory, Callback on_change,
+                             std::chrono::milliseconds settle_time)
+            : directory_(std::move(directory)), on_change(std::move(on_change)), settle_time(settle_time) {
+        if (!std::filesystem::is_directory(directory_))
+            throw std::runtime_error("Failed to watch " + directory_.string() + ": not a directory");
+        thread = std::thread(&FileWatcher::watch, this);
+    }
+
+    FileWatcher::~FileWatcher() {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex);
+            stopping = true;
+        }
+        stop_condition.notify_one();
+        thread.join();
+    }
+
+    void FileWatcher::watch() {
+        using Stamp = std::pair<uintmax_t, std::filesystem::file_time_type>;
+        auto scan = [this] {
+            std::map<std::string, Stamp> stamps;
+            std::error_code ec;
+            for (const auto& entry: std::filesystem::directory_iterator(directory_, ec)) {
+                std::error_code entry_ec;
+                if (!entry.is_regular_file(entry_ec)) continue;
+                const auto size = entry.file_size(entry_ec);
+                const auto time = entry.last_write_time(entry_ec);
+                if (!entry_ec) stamps.emplace(entry.path().filename().string(), Stamp{size, time});
+            }
+            return stamps;
+        };
+        // Half of settle time between scans, changes are reported after a quiet scan
+        const auto period = std::max(settle_time / 2, std::chrono::milliseconds(100));
+        auto stamps = scan();
+        std::set<std::string> changed;
+        std::unique_lock<std::mutex> lock(stop_mutex);
+        while (!stop_condition.wait_for(lock, period, [this] { return stopping; })) {
+            auto current = scan();
+            bool quiet = true;
+            for (const auto& [name, stamp]: current) {
+                const auto it = stamps.find(name);
+                if (it == stamps.end() || it->second != stamp) {
+                    changed.insert(name);
+                    quiet = false;
+                }
+            }
+            for (const auto& entry: stamps) {
+                if (!current.count(entry.first)) {
+                    changed.insert(entry.first);
+                    quiet = false;
+                }
+            }
+            stamps = std::move(current);
+            if (quiet && !changed.empty()) {
+                lock.unlock();
+                on_change(std::vector<std::string>(changed.begin(), changed.end()));
+                lock.lock();
+                changed.clear();
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,60 @@
+#ifndef USV_FILEWATCHER_H
+#define USV_FILEWATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace USV {
+    /**
+     * \brief      Watches files of one directory (not recursively) on a background thread.
+     *
+     * Uses inotify on Linux: a file is reported once it's closed after writing, moved in or
+     * deleted. Elsewhere the directory is polled for size and modification time changes.
+     * Changes are collected until the directory stays quiet for the settle time, so a solver
+     * writing several files produces one notification.
+     */
+    class FileWatcher {
+    public:
+        //! Receives sorted names of changed files relative to directory, called on watcher thread
+        using Callback = std::function<void(const std::vector<std::string>&)>;
+
+        /**
+         * @throws std::runtime_error if directory can't be watched
+         */
+        FileWatcher(std::filesystem::path directory, Callback on_change,
+                    std::chrono::milliseconds settle_time = std::chrono::milliseconds(300));
+
+        //! Stops watching, waits for callback in progress
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        [[nodiscard]] inline const std::filesystem::path& directory() const { return directory_; }
+
+    private:
+        std::filesystem::path directory_;
+        Callback on_change;
+        std::chrono::milliseconds settle_time;
+#ifdef __linux__
+        int fd{-1}; //! inotify descriptor
+        int stop_pipe[2]{-1, -1}; //! Written to wake the thread up for stop
+#else
+        std::mutex stop_mutex;
+        std::condition_variable stop_condition;
+        bool stopping{false};
+#endif
+        std::thread thread;
+
+        void watch();
+    };
+}
+
+#endif //USV_FILEWATCHER_H
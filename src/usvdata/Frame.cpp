@@ -1,8 +1,80 @@
 #include "Frame.h"
 #include <GeographicLib/Geodesic.hpp>
+#include <algorithm>
+#include "Simd.h"
 
 namespace USV {
     using namespace GeographicLib;
+    using Simd::Double2;
+    using Simd::sqrt;
+
+    namespace {
+        // Validity range of the local series [deg]
+        constexpr double local_range = 1.0;
+
+        // Taylor series, exact in double precision for |x| < 0.1
+        template<typename T>
+        inline T sin_small(T x) {
+            T x2 = x * x;
+            return x * (T(1) - x2 / T(6) * (T(1) - x2 / T(20) * (T(1) - x2 / T(42) * (T(1) - x2 / T(72)))));
+        }
+
+        template<typename T>
+        inline T cos_small(T x) {
+            T x2 = x * x;
+            return T(1) - x2 / T(2) * (T(1) - x2 / T(12) * (T(1) - x2 / T(30) * (T(1) - x2 / T(56) *
+                                                                                   (T(1) - x2 / T(90)))));
+        }
+
+        /**
+         * Gauss mid-latitude solution of the inverse geodesic problem on the sphere with
+         * meridional and prime vertical radii of the mid-latitude, written without
+         * transcendental functions.
+         * @param half_dlat half of latitude difference [rad]
+         * @param half_dlon half of longitude difference [rad]
+         * @param north,east Result [m]
+         */
+        template<typename T>
+        inline void local_series(T half_dlat, T half_dlon, double sin_lat0, double cos_lat0, T& north, T& east) {
+            const double a = Constants::WGS84_a();
+            const double f = Constants::WGS84_f();
+            const double e2 = f * (2 - f);
+
+            T sh = sin_small(half_dlat), ch = cos_small(half_dlat);
+            T sk = sin_small(half_dlon), ck = cos_small(half_dlon);
+            // mid latitude
+            T sin_m = T(sin_lat0) * ch + T(cos_lat0) * sh;
+            T cos_m = T(cos_lat0) * ch - T(sin_lat0) * sh;
+            // radii of curvature
+            T w2 = T(1) - T(e2) * sin_m * sin_m;
+            T n = T(a) / sqrt(w2);
+            T m = n * T(1 - e2) / w2;
+            // chord components along mean azimuth
+            T x = T(2) * m * sh * ck;
+            T y = T(2) * n * sk * cos_m;
+            // arc to chord ratio, u = sin(sigma / 2)
+            T u2 = (x * x + y * y) / (T(4) * m * n);
+            T ratio = T(1) + u2 * (T(1.0 / 6) + u2 * (T(3.0 / 40) + u2 * T(5.0 / 112)));
+            // half of meridian convergence: tan(g) = tan(dlon/2) sin(lat_m) / cos(dlat/2)
+            T tg = sk * sin_m / (ck * ch);
+            T cg = T(1) / sqrt(T(1) + tg * tg);
+            T sg = tg * cg;
+            north = ratio * (x * cg + y * sg);
+            east = ratio * (y * cg - x * sg);
+        }
+
+        inline double wrap_lon(double dlon) {
+            if (dlon >= 180) return dlon - 360;
+            if (dlon < -180) return dlon + 360;
+            return dlon;
+        }
+    }
+
+    Frame::Frame(double lat, double lon) : _refLat(lat), _refLon(lon) {
+        _sinRefLat = std::sin(lat * Math::degree());
+        _cosRefLat = std::cos(lat * Math::degree());
+        _maxDeltaLon = local_range / std::max(_cosRefLat, 0.1);
+    }
 
     Vector2 Frame::fromWgs(double lat, double lon) const {
         static const auto invNauticalMile = 1 / Constants::nauticalmile();
@@ -15,6 +87,70 @@ namespace USV {
         return {dist * cos(angle), dist * sin(angle)};
     }
 
+    template<typename Accessor>
+    void Frame::fromWgsBatch(Accessor coordinate, std::size_t count, Vector2* result, Projection projection) const {
+        if (projection == Projection::Geodesic) {
+            for (std::size_t i = 0; i < count; ++i) {
+                const LatLon c = coordinate(i);
+                result[i] = fromWgs(c.lat, c.lon);
+            }
+            return;
+        }
+
+        const double invNauticalMile = 1 / Constants::nauticalmile();
+        const double half_degree = Math::degree() / 2;
+        auto in_range = [this](double dlat, double dlon) {
+            return std::abs(dlat) <= local_range && std::abs(dlon) <= _maxDeltaLon;
+        };
+        auto convert_one = [&](const LatLon& c) -> Vector2 {
+            const double dlat = c.lat - _refLat, dlon = wrap_lon(c.lon - _refLon);
+            if (!in_range(dlat, dlon)) return fromWgs(c.lat, c.lon);
+            double north, east;
+            local_series(dlat * half_degree, dlon * half_degree, _sinRefLat, _cosRefLat, north, east);
+            return {north * invNauticalMile, east * invNauticalMile};
+        };
+
+        std::size_t i = 0;
+        for (; i + 1 < count; i += 2) {
+            const LatLon c0 = coordinate(i), c1 = coordinate(i + 1);
+            const double dlat0 = c0.lat - _refLat, dlon0 = wrap_lon(c0.lon - _refLon);
+            const double dlat1 = c1.lat - _refLat, dlon1 = wrap_lon(c1.lon - _refLon);
+            if (!in_range(dlat0, dlon0) || !in_range(dlat1, dlon1)) {
+                result[i] = convert_one(c0);
+                result[i + 1] = convert_one(c1);
+                continue;
+            }
+            Double2 north(0.0), east(0.0);
+            local_series(Double2(dlat0, dlat1) * Double2(half_degree),
+                         Double2(dlon0, dlon1) * Double2(half_degree),
+                         _sinRefLat, _cosRefLat, north, east);
+            north = north * Double2(invNauticalMile);
+            east = east * Double2(invNauticalMile);
+            double n[2], e[2];
+            north.store(n);
+            east.store(e);
+            result[i] = {n[0], e[0]};
+            result[i + 1] = {n[1], e[1]};
+        }
+        if (i < count)
+            result[i] = convert_one(coordinate(i));
+    }
+
+    void Frame::fromWgs(const LatLon* coordinates, std::size_t count, Vector2* result, Projection projection) const {
+        fromWgsBatch([coordinates](std::size_t i) { return coordinates[i]; }, count, result, projection);
+    }
+
+    std::vector<Vector2> Frame::fromWgs(const std::vector<LatLon>& coordinates, Projection projection) const {
+        std::vector<Vector2> result(coordinates.size());
+        fromWgs(coordinates.data(), coordinates.size(), result.data(), projection);
+        return result;
+    }
+
+    void Frame::fromGeoJSON(const Vector2* points, std::size_t count, Vector2* result, Projection projection) const {
+        fromWgsBatch([points](std::size_t i) { return LatLon{points[i].y(), points[i].x()}; }, count, result,
+                     projection);
+    }
+
     void Frame::toWgs(const Vector2& vector, double& lat, double& lon) const {
         auto wgs84 = Geodesic::WGS84();
         auto azi1 = Math::atan2d(vector.y(), vector.x());
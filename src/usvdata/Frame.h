@@ -2,19 +2,44 @@
 #define USV_FRAME_H_
 
 #include "Vector2.h"
+#include <cstddef>
+#include <vector>
 
 namespace USV {
+    /**
+     * \brief      WGS84 coordinates in degrees
+     */
+    struct LatLon {
+        double lat;
+        double lon;
+    };
+
     /**
      * \brief      Defines converter class
      */
     class Frame {
     public:
+        /**
+         * \brief      Method of batch conversion
+         *
+         * Geodesic    exact geodesic inverse problem for every point
+         * Local       mid-latitude series around the reference point. For reference latitudes up to
+         *             84 degrees, deviation from the exact geodesic is below 0.1 m within 1 degree of
+         *             latitude (and 1 degree of parallel arc) from the reference point, and below
+         *             0.012 m within 0.5 degree. Points outside are converted exactly. Bounds are
+         *             checked by usvdata_bench --check.
+         */
+        enum class Projection {
+            Geodesic,
+            Local
+        };
+
         /**
          * \brief		Constructs a frame instance.
          * \param		lat		Reference point latitude
          * \param		lon		Reference point longitude
          */
-        Frame(double lat, double lon) : _refLat(lat), _refLon(lon) {};
+        Frame(double lat, double lon);
 
         /**
          * \brief		Converts WGS84 coordinates to coordinates in reference frame using.
@@ -23,6 +48,29 @@ namespace USV {
          */
         [[nodiscard]] Vector2 fromWgs(double lat, double lon) const;
 
+        /**
+         * \brief		Converts array of WGS84 coordinates to coordinates in reference frame.
+         * \param		coordinates     source coordinates
+         * \param		count           number of coordinates
+         * \param		result          destination array of at least count elements
+         * \param		projection      conversion method
+         */
+        void fromWgs(const LatLon* coordinates, std::size_t count, Vector2* result,
+                     Projection projection = Projection::Local) const;
+
+        [[nodiscard]] std::vector<Vector2> fromWgs(const std::vector<LatLon>& coordinates,
+                                                   Projection projection = Projection::Local) const;
+
+        /**
+         * \brief		Converts array of GeoJSON positions (longitude, latitude) to coordinates in reference frame.
+         * \param		points          source positions
+         * \param		count           number of positions
+         * \param		result          destination array of at least count elements, may be the same as points
+         * \param		projection      conversion method
+         */
+        void fromGeoJSON(const Vector2* points, std::size_t count, Vector2* result,
+                         Projection projection = Projection::Local) const;
+
         /**
          * \brief		Convertes coordinates in reference frame to WGS84 coordinates.
          * \param       vector vector with coordinates in reference frame
@@ -42,6 +90,13 @@ namespace USV {
     private:
         double _refLat;
         double _refLon;
+        // Precomputed for Projection::Local
+        double _sinRefLat;
+        double _cosRefLat;
+        double _maxDeltaLon;
+
+        template<typename Accessor>
+        void fromWgsBatch(Accessor coordinate, std::size_t count, Vector2* result, Projection projection) const;
     };
 }
 
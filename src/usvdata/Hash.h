@@ -0,0 +1,28 @@
+#ifndef USV_HASH_H
+#define USV_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace USV {
+    constexpr uint64_t fnv1a_offset_basis = 14695981039346656037ull;
+
+    /**
+     * \brief      64-bit FNV-1a hash. Pass previous result as hash to hash several pieces as one.
+     */
+    inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = fnv1a_offset_basis) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    inline uint64_t fnv1a(std::string_view s, uint64_t hash = fnv1a_offset_basis) {
+        return fnv1a(s.data(), s.size(), hash);
+    }
+}
+
+#endif //USV_HASH_H
@@ -3,8 +3,8 @@
 
 #include "CurvedPath.h"
 #include "InputTypes.h"
+#include "MappedFile.h"
 #include <spotify/json.hpp>
-#include <sstream>
 #include <filesystem>
 #include <iostream>
 
@@ -340,46 +340,53 @@ namespace spotify::json {
 }
 
 namespace USV::InputUtils {
+    /**
+     * \brief Decodes JSON file into data. Failures throw if R, otherwise they are reported to log and data is kept.
+     * @param log Progress and failure messages
+     */
     template<bool R = false, typename T>
-    void load_from_json_file(T* data, const std::filesystem::path& filename) {
+    void load_from_json_file(T* data, const std::filesystem::path& filename, std::ostream& log = std::cout) {
         using namespace spotify::json;
 
         if (filename.empty()) {
             if constexpr (R) { throw std::runtime_error("Empty filename "); }
             else { return; }
         }
-        std::cout << "Loading `" << filename << "` ... ";
-        std::ifstream ifs(filename);
-        if (!ifs.good()) {
+        log << "Loading `" << filename << "` ... ";
+        // Decode straight from the mapped file, no intermediate copies of the contents
+        MappedFile file;
+        try {
+            file = MappedFile(filename);
+        } catch (const std::runtime_error&) {
             if constexpr (R) { throw std::runtime_error("Failed to open " + filename.string()); }
             else {
-                std::cout << "failed to open" << std::endl;
+                log << "failed to open" << std::endl;
                 return;
             }
         }
-        std::stringstream buffer;
-        buffer << ifs.rdbuf();
-        if (!try_decode<T>(*data, buffer.str())) {
+        if (!try_decode<T>(*data, file.data(), file.size())) {
             if constexpr(R) {
                 throw std::runtime_error("Failed to parse " + filename.string());
             } else {
-                std::cout << "failed to parse" << std::endl;
+                log << "failed to parse" << std::endl;
                 return;
             }
         }
-        std::cout << "OK" << std::endl;
+        log << "OK" << std::endl;
     }
 
     template<bool R = false, typename T>
-    void load_from_json_file(std::unique_ptr<T>& data, const std::filesystem::path& filename) {
+    void load_from_json_file(std::unique_ptr<T>& data, const std::filesystem::path& filename,
+                             std::ostream& log = std::cout) {
         data = std::make_unique<T>();
-        load_from_json_file<R>(data.get(), filename);
+        load_from_json_file<R>(data.get(), filename, log);
     }
 
     template<bool R = false, typename T>
-    void load_from_json_file(std::shared_ptr<T>& data, const std::filesystem::path& filename) {
+    void load_from_json_file(std::shared_ptr<T>& data, const std::filesystem::path& filename,
+                             std::ostream& log = std::cout) {
         data = std::make_shared<T>();
-        load_from_json_file<R>(data.get(), filename);
+        load_from_json_file<R>(data.get(), filename, log);
     }
 }
 
@@ -1,6 +1,11 @@
 #include "InputUtils.h"
 #include "InputDataJsonDefines.h"
+#include "Parallel.h"
+#include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <sstream>
+#include <type_traits>
 
 namespace USV::InputUtils {
     namespace {
@@ -49,34 +54,108 @@ namespace USV::InputUtils {
         };
     }
 
-    InputTypes::InputData loadInputData(const std::string& data_directory) {
-        InputTypes::InputData data;
+    const InputTypes::DataFilenames& dataFilenames(const std::filesystem::path& data_directory) {
+        if (file_exists(data_directory / data_filenames_native.navigationParameters)) {
+            if (file_exists(data_directory / data_filenames_native.navigationProblem))
+                return data_filenames_native;
+            return data_filenames_argument_like;
+        }
+        return data_filenames_kt;
+    }
+
+    bool isCaseDirectory(const std::filesystem::path& data_directory) {
+        const auto& filenames = dataFilenames(data_directory);
+        return file_exists(data_directory / filenames.navigationParameters) &&
+               file_exists(data_directory / filenames.navigationProblem);
+    }
+
+    namespace {
+        InputTypes::InputData load_files(const std::string& data_directory,
+                                         const std::function<bool(std::string_view)>& wanted) {
+            InputTypes::InputData data;
 
-        data.directory = {data_directory};
-        if(file_exists(data.directory / data_filenames_native.navigationParameters)){
-            if(file_exists(data.directory / data_filenames_native.navigationProblem)){
-                data.data_filenames = &data_filenames_native;
-            }else{
-                data.data_filenames = &data_filenames_argument_like;
+            data.directory = {data_directory};
+            data.data_filenames = &dataFilenames(data.directory);
+
+            auto& filenames = *data.data_filenames;
+
+            const auto& dir = data.directory;
+            // Files are independent, decode them concurrently. Log of each file is printed in this order afterwards.
+            const std::function<void(std::ostream&)> loaders[] = {
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.navigationParameters))
+                            load_from_json_file<true>(data.navigationParameters, dir / filenames.navigationParameters,
+                                                      log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.navigationProblem))
+                            load_from_json_file<true>(data.navigationProblem, dir / filenames.navigationProblem, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.route)) load_from_json_file<true>(data.route, dir / filenames.route, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.maneuvers))
+                            load_from_json_file(data.maneuvers, dir / filenames.maneuvers, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.targets_paths))
+                            load_from_json_file(data.targets_paths, dir / filenames.targets_paths, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.targets_real_paths))
+                            load_from_json_file(data.targets_real_paths, dir / filenames.targets_real_paths, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.settings))
+                            load_from_json_file<true>(data.settings, dir / filenames.settings, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.constraints))
+                            load_from_json_file(data.constraints, dir / filenames.constraints, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(filenames.analyse))
+                            load_from_json_file(data.analyse_result, dir / filenames.analyse, log);
+                    },
+                    [&](std::ostream& log) {
+                        if (wanted(wasted_maneuvers_filename))
+                            load_from_json_file(data.wasted_maneuvers, dir / wasted_maneuvers_filename, log);
+                    },
+            };
+            constexpr size_t loaders_count = std::extent_v<decltype(loaders)>;
+            std::ostringstream logs[loaders_count];
+            auto print_logs = [&logs] {
+                for (const auto& log: logs) std::cout << log.str();
+                std::cout.flush();
+            };
+            try {
+                Parallel::parallelFor(loaders_count, [&](size_t i) { loaders[i](logs[i]); });
+            } catch (...) {
+                print_logs();
+                throw;
             }
-        }else{
-            data.data_filenames = &data_filenames_kt;
+            print_logs();
+            return data;
         }
+    }
 
+    InputTypes::InputData loadInputData(const std::string& data_directory, bool load_paths, bool load_constraints) {
+        const auto& filenames = dataFilenames(data_directory);
+        return load_files(data_directory, [&](std::string_view filename) {
+            if (filename == filenames.route || filename == filenames.maneuvers || filename == filenames.targets_paths ||
+                filename == wasted_maneuvers_filename)
+                return load_paths;
+            if (filename == filenames.constraints) return load_constraints;
+            return true;
+        });
+    }
 
-        auto& filenames = *data.data_filenames;
-
-        load_from_json_file<true>(data.navigationParameters, data.directory / filenames.navigationParameters);
-        load_from_json_file<true>(data.navigationProblem, data.directory / filenames.navigationProblem);
-        load_from_json_file<true>(data.route, data.directory / filenames.route);
-        load_from_json_file(data.maneuvers, data.directory / filenames.maneuvers);
-        load_from_json_file(data.targets_paths, data.directory / filenames.targets_paths);
-        load_from_json_file(data.targets_real_paths, data.directory / filenames.targets_real_paths);
-        load_from_json_file<true>(data.settings, data.directory / filenames.settings);
-        load_from_json_file(data.constraints, data.directory / filenames.constraints);
-        load_from_json_file(data.analyse_result, data.directory / filenames.analyse);
-        load_from_json_file(data.wasted_maneuvers, data.directory / "wasted_maneuvers.json");
-        return data;
+    InputTypes::InputData loadInputFiles(const std::string& data_directory,
+                                         const std::vector<std::string_view>& filenames) {
+        return load_files(data_directory, [&](std::string_view filename) {
+            return std::find(filenames.begin(), filenames.end(), filename) != filenames.end();
+        });
     }
 
 }
@@ -2,12 +2,40 @@
 #define USV_INPUTUTILS_H
 
 #include "InputTypes.h"
+#include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
 namespace USV::InputUtils {
 
-    InputTypes::InputData loadInputData(const std::string& data_directory);
+    constexpr std::string_view wasted_maneuvers_filename = "wasted_maneuvers.json";
+
+    /**
+     * \brief File names of case in data_directory, depends on naming convention used there
+     */
+    const InputTypes::DataFilenames& dataFilenames(const std::filesystem::path& data_directory);
+
+    /**
+     * \brief Whether data_directory has navigation and targets files of some naming convention
+     */
+    bool isCaseDirectory(const std::filesystem::path& data_directory);
+
+    /**
+     * \brief Loads case files
+     * @param load_paths Load route, maneuvers, targets paths and wasted maneuvers
+     * @param load_constraints Load constraints
+     */
+    InputTypes::InputData loadInputData(const std::string& data_directory, bool load_paths = true,
+                                        bool load_constraints = true);
+
+    /**
+     * \brief Loads only given files of case, named as in dataFilenames(). Usual data of
+     *        other files is left empty, including required navigation and settings.
+     */
+    InputTypes::InputData loadInputFiles(const std::string& data_directory,
+                                         const std::vector<std::string_view>& filenames);
 
 }
 
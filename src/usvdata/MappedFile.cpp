@@ -0,0 +1,126 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define USV_MAPPED_FILE_WIN32
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USV_MAPPED_FILE_POSIX
+#endif
+
+namespace USV {
+    namespace {
+        std::vector<char> read_file(const std::filesystem::path& filename) {
+            std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+            if (!ifs.good()) throw std::runtime_error("Failed to open " + filename.string());
+            std::vector<char> buffer(static_cast<size_t>(ifs.tellg()));
+            ifs.seekg(0);
+            if (!ifs.read(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+                throw std::runtime_error("Failed to read " + filename.string());
+            return buffer;
+        }
+    }
+
+    MappedFile::MappedFile(const std::filesystem::path& filename) {
+#if defined(USV_MAPPED_FILE_POSIX)
+        const int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Failed to open " + filename.string());
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to stat " + filename.string());
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(p);
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+#elif defined(USV_MAPPED_FILE_WIN32)
+        HANDLE file = ::CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open " + filename.string());
+        LARGE_INTEGER file_size;
+        if (!::GetFileSizeEx(file, &file_size)) {
+            ::CloseHandle(file);
+            throw std::runtime_error("Failed to stat " + filename.string());
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ > 0) {
+            mapping_ = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping_) {
+                data_ = static_cast<const char*>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+                if (data_) {
+                    mapped_ = true;
+                } else {
+                    ::CloseHandle(mapping_);
+                    mapping_ = nullptr;
+                }
+            }
+        }
+        ::CloseHandle(file);
+#endif
+        if (!mapped_) {
+            // No mapping on this platform, mapping failed (e.g. special files) or file is empty
+            buffer_ = read_file(filename);
+            data_ = buffer_.data();
+            size_ = buffer_.size();
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        unmap();
+    }
+
+    MappedFile::MappedFile(MappedFile&& o) noexcept {
+        *this = std::move(o);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            unmap();
+            buffer_ = std::move(o.buffer_);
+            data_ = o.mapped_ ? o.data_ : buffer_.data();
+            size_ = o.size_;
+            mapped_ = o.mapped_;
+#ifdef _WIN32
+            mapping_ = o.mapping_;
+            o.mapping_ = nullptr;
+#endif
+            o.data_ = nullptr;
+            o.size_ = 0;
+            o.mapped_ = false;
+        }
+        return *this;
+    }
+
+    void MappedFile::unmap() {
+        if (mapped_) {
+#if defined(USV_MAPPED_FILE_POSIX)
+            ::munmap(const_cast<char*>(data_), size_);
+#elif defined(USV_MAPPED_FILE_WIN32)
+            ::UnmapViewOfFile(data_);
+            ::CloseHandle(mapping_);
+            mapping_ = nullptr;
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+        buffer_.clear();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef USV_MAPPEDFILE_H
+#define USV_MAPPEDFILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+namespace USV {
+    /**
+     * \brief      Read-only view of whole file contents. The file is memory mapped where
+     *             the platform allows it (POSIX mmap, Windows file mapping), otherwise it
+     *             is read into memory once.
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        /**
+         * \brief Maps file
+         * \throws std::runtime_error if the file can't be opened or read
+         */
+        explicit MappedFile(const std::filesystem::path& filename);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& o) noexcept;
+
+        MappedFile& operator=(MappedFile&& o) noexcept;
+
+        [[nodiscard]] inline const char* data() const { return data_; }
+
+        [[nodiscard]] inline size_t size() const { return size_; }
+
+        [[nodiscard]] inline bool empty() const { return size_ == 0; }
+
+        //! True if contents are mapped, false if they were read into memory
+        [[nodiscard]] inline bool isMapped() const { return mapped_; }
+
+    private:
+        const char* data_{};
+        size_t size_{0};
+        bool mapped_{false};
+        std::vector<char> buffer_{};
+#ifdef _WIN32
+        void* mapping_{};
+#endif
+
+        void unmap();
+    };
+}
+
+#endif //USV_MAPPEDFILE_H
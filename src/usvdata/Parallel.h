@@ -0,0 +1,79 @@
+#ifndef USV_PARALLEL_H
+#define USV_PARALLEL_H
+
+/**
+ * \file       Parallel.h
+ * \brief      Minimal fork-join helpers for loading and conversion. Work items write
+ *             to their own slots, so results do not depend on the number of threads.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace USV::Parallel {
+    /**
+     * \brief Number of threads used by parallel algorithms. USV_THREADS environment
+     *        variable if set, hardware concurrency otherwise.
+     */
+    inline size_t threadCount() {
+        static const size_t count = [] {
+            if (const char* env = std::getenv("USV_THREADS")) {
+                const long n = std::strtol(env, nullptr, 10);
+                if (n > 0) return static_cast<size_t>(n);
+            }
+            return static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()));
+        }();
+        return count;
+    }
+
+    /**
+     * \brief Calls body(i) for every i in [0, count) on up to threadCount() threads,
+     *        the calling thread included. Items are taken dynamically in chunks of grain.
+     *        If some calls throw, exception of the lowest i is rethrown after all threads finish.
+     * @param max_threads Overrides threadCount() if not 0
+     */
+    template<typename Body>
+    void parallelFor(size_t count, Body&& body, size_t grain = 1, size_t max_threads = 0) {
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = (count + grain - 1) / grain;
+        const size_t threads = std::min(max_threads ? max_threads : threadCount(), chunks);
+        if (threads <= 1) {
+            for (size_t i = 0; i < count; ++i) body(i);
+            return;
+        }
+
+        std::atomic<size_t> next_chunk{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        size_t error_index = count;
+        auto worker = [&] {
+            for (size_t chunk; (chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+                const size_t end = std::min(count, (chunk + 1) * grain);
+                for (size_t i = chunk * grain; i < end; ++i) {
+                    try {
+                        body(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (i < error_index) {
+                            error_index = i;
+                            error = std::current_exception();
+                        }
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (auto& thread: pool) thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+#endif //USV_PARALLEL_H
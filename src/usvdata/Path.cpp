@@ -1,4 +1,5 @@
 #include "Path.h"
+#include <algorithm>
 
 namespace USV {
 
@@ -6,7 +7,12 @@ namespace USV {
         if (t < 0 || t - _duration > 0.01) {
             throw std::out_of_range("Time exceeds duration of segment");
         }
+        return positionUnchecked(t);
+    }
+
+    Path::Position USV::Path::Segment::positionUnchecked(double t) const {
         if (t > _duration) t = _duration;
+        if (t < 0) t = 0;
         double speed = _length / _duration;
         auto course = _begin_angle;
         Vector2 delta;
@@ -199,30 +205,40 @@ namespace USV {
         }
 
         segments.push_back({key, segment});
+        keys.push_back(key);
     }
 
+    size_t Path::segmentIndex(double t) const {
+        if (t > 0)
+            return static_cast<size_t>(std::lower_bound(keys.begin(), keys.end(), t) - keys.begin());
+        return keys.size();
+    }
 
-    Path::constItr Path::segment(double t) const {
-        if (t > 0) {
-            constItr it;
-            auto first = segments.begin();
-            auto count = segments.size();
-            while (count > 0) {
-                it = first;
-                auto step = count / 2;
-                std::advance(it, step);
-                if (it->first < t) {
-                    first = ++it;
-                    count -= step + 1;
-                } else
-                    count = step;
-            }
 
-            if (first != segments.end()) return first;
-        }
+    Path::constItr Path::segment(double t) const {
+        auto index = segmentIndex(t);
+        if (index < segments.size()) return segments.begin() + static_cast<std::ptrdiff_t>(index);
         throw std::out_of_range("Time exceeds duration of path");
     }
 
+    std::optional<Path::Position> Path::tryPosition(double t) const {
+        if (!covers(t)) return std::nullopt;
+        const auto& item = segments[segmentIndex(t)];
+        return item.second.positionUnchecked(t + item.second._duration - item.first);
+    }
+
+    void Path::sample(const double* times, size_t count, std::optional<Position>* result) const {
+        Cursor cursor(*this);
+        for (size_t i = 0; i < count; ++i)
+            result[i] = cursor.tryPosition(times[i]);
+    }
+
+    std::vector<std::optional<Path::Position>> Path::sample(const std::vector<double>& times) const {
+        std::vector<std::optional<Position>> result(times.size());
+        sample(times.data(), times.size(), result.data());
+        return result;
+    }
+
     Path::Position Path::position(double t) const {
         auto segment_it = segment(t);
         auto time = t + segment_it->second._duration - segment_it->first;
@@ -233,6 +249,7 @@ namespace USV {
         auto segment_it = segment(t);
         auto segment = segment_it->second;
         segment.cut(t + segment_it->second._duration - segment_it->first);
+        keys.resize(static_cast<size_t>(segment_it - segments.cbegin()));
         segments.erase(segment_it, segments.end());
         appendSegment(segment);
     }
@@ -256,18 +273,23 @@ namespace USV {
 
     Path::Path(const CurvedPath &curved_path, const Frame &reference_frame) : start_time(
             static_cast<double>(curved_path.start_time)) {
-        for (const auto &segment: curved_path.items) {
-            Vector2 localPos = reference_frame.fromWgs(segment.lat, segment.lon);
-            Angle begin_angle = Angle::Degrees(segment.begin_angle);
+        const auto n = curved_path.items.size();
+        // Segment start points followed by course points, converted in one batch
+        std::vector<LatLon> coordinates(2 * n);
+        for (size_t i = 0; i < n; ++i) {
+            const auto& segment = curved_path.items[i];
+            coordinates[i] = {segment.lat, segment.lon};
             Frame frame_local(segment.lat, segment.lon);
-            auto length = segment.length;
-            auto course_point = Vector2::polar(length, begin_angle);
-            double lat_course, lon_course;
-            frame_local.toWgs(course_point, lat_course, lon_course);
-            course_point = reference_frame.fromWgs(lat_course, lon_course) - localPos;
-            begin_angle = atan2(course_point.y(), course_point.x());
+            auto course_point = Vector2::polar(segment.length, Angle::Degrees(segment.begin_angle));
+            frame_local.toWgs(course_point, coordinates[n + i].lat, coordinates[n + i].lon);
+        }
+        const auto local = reference_frame.fromWgs(coordinates);
 
-            if (segment.curve == 0) length = course_point.r();
+        for (size_t i = 0; i < n; ++i) {
+            const auto& segment = curved_path.items[i];
+            const Vector2& localPos = local[i];
+            const auto course_point = local[n + i] - localPos;
+            Angle begin_angle = atan2(course_point.y(), course_point.x());
 
             appendSegment({{localPos.y(),localPos.x()}, M_PI_2 - begin_angle.radians(), -segment.curve, segment.length,
                            segment.duration, segment.port_dev, segment.starboard_dev});
@@ -283,13 +305,11 @@ namespace USV {
         return itr->second.end();
     }
 
-    std::vector<Vector2> Path::getPointsPath(const double angle_increment) const {
-        std::vector<Vector2> points;
-        // we'll need at least two points for every segment
-        points.reserve(segments.size() * 2);
+    template<typename Out>
+    void Path::forEachPathPoint(const double angle_increment, Out&& out) const {
         for (const auto& segment:segments) {
             auto& s = segment.second;
-            points.push_back(s._start_point);
+            out(s._start_point);
             if (0.0000001 < std::abs(s._curve)) {
                 // For arcs
                 auto b_cos = std::cos(s._begin_angle.radians());
@@ -301,15 +321,68 @@ namespace USV {
                 for (size_t i = 0; i < n; ++i) {
                     auto x_ = std::sin(angle_increment * i);
                     auto y_ = sign * (1 - std::cos(angle_increment * i));
-                    points.push_back(s._start_point + r * Vector2(x_ * b_cos - y_ * b_sin, x_ * b_sin + y_ * b_cos));
+                    out(s._start_point + r * Vector2(x_ * b_cos - y_ * b_sin, x_ * b_sin + y_ * b_cos));
                 }
             } else {
-                points.push_back(s._start_point + s.O_V * s._duration);
+                out(s._start_point + s.O_V * s._duration);
             }
         }
+    }
+
+    std::vector<Vector2> Path::getPointsPath(const double angle_increment) const {
+        std::vector<Vector2> points;
+        // we'll need at least two points for every segment
+        points.reserve(segments.size() * 2);
+        forEachPathPoint(angle_increment, [&points](const Vector2& point) { points.push_back(point); });
         return points;
     }
 
+    size_t Path::pointsPathCount(const double angle_increment) const {
+        size_t count = 0;
+        for (const auto& segment:segments) {
+            auto& s = segment.second;
+            count += 1 + (0.0000001 < std::abs(s._curve)
+                          ? static_cast<size_t>(std::abs(s._length * s._curve) / angle_increment) : 1);
+        }
+        return count;
+    }
+
+    void Path::writePointsPath(float* out, const double angle_increment) const {
+        forEachPathPoint(angle_increment, [&out](const Vector2& point) {
+            *out++ = static_cast<float>(point.x());
+            *out++ = static_cast<float>(point.y());
+        });
+    }
+
+    Path::constItr Path::Cursor::segment(double t) {
+        const auto& keys = path->keys;
+        // Walk a few segments from the previous one, then fall back to binary search
+        constexpr size_t max_steps = 4;
+        size_t steps = 0;
+        if (index < keys.size() && t > 0) {
+            while (index > 0 && keys[index - 1] >= t && steps++ < max_steps) --index;
+            while (index < keys.size() && keys[index] < t && steps++ < max_steps) ++index;
+        }
+        if (index >= keys.size() || t <= 0 || keys[index] < t ||
+            (index > 0 && keys[index - 1] >= t)) {
+            const auto found = path->segmentIndex(t);
+            if (found >= keys.size()) throw std::out_of_range("Time exceeds duration of path");
+            index = found;
+        }
+        return path->segments.begin() + static_cast<std::ptrdiff_t>(index);
+    }
+
+    Path::Position Path::Cursor::position(double t) {
+        auto segment_it = segment(t);
+        return segment_it->second.position(t + segment_it->second._duration - segment_it->first);
+    }
+
+    std::optional<Path::Position> Path::Cursor::tryPosition(double t) {
+        if (!path->covers(t)) return std::nullopt;
+        auto segment_it = segment(t);
+        return segment_it->second.positionUnchecked(t + segment_it->second._duration - segment_it->first);
+    }
+
     const Path::SegmentsType &Path::getSegments() const {
         return segments;
     }
@@ -6,7 +6,11 @@
 #include "CurvedPath.h"
 #include "Frame.h"
 
+#include <optional>
+
 namespace USV {
+    class TrajectoryTable;
+
     class Path {
     private:
         double start_time;
@@ -33,6 +37,13 @@ namespace USV {
 
             friend class Path;
 
+            friend class TrajectoryTable;
+
+            /**
+             * \brief Position without range check, t is clamped to [0, duration]
+             */
+            [[nodiscard]] Position positionUnchecked(double t) const;
+
         public:
             Segment(Vector2 start_point, Angle beginAngle, double curve, double length, double duration, double port_dev = 0, double starboard_dev = 0);
 
@@ -108,13 +119,70 @@ namespace USV {
 
     private:
         SegmentsType segments{};
+        //! End times of segments, duplicated contiguously for the lookup
+        std::vector<double> keys{};
+
+        /**
+         * \brief Index of the first segment ending not earlier than t, size() if there is none
+         */
+        [[nodiscard]] size_t segmentIndex(double t) const;
     public:
+        /**
+         * \brief Segment lookup for nearly monotonic time sweeps (playback, sampling).
+         *        Remembers the last found segment and moves from it, so the lookup of the
+         *        same or the adjacent segment costs a couple of comparisons. Large jumps fall
+         *        back to binary search. Path must outlive the cursor and stay unmodified.
+         */
+        class Cursor {
+            const Path* path;
+            size_t index{0};
+        public:
+            explicit Cursor(const Path& path) : path(&path) {}
+
+            /**
+             * \brief Same as Path::segment(t)
+             */
+            [[nodiscard]] constItr segment(double t);
+
+            /**
+             * \brief Same as Path::position(t)
+             */
+            [[nodiscard]] Position position(double t);
+
+            /**
+             * \brief Same as Path::tryPosition(t)
+             */
+            [[nodiscard]] std::optional<Position> tryPosition(double t);
+        };
+
         void appendSegment(Segment segment);
 
         [[nodiscard]] const SegmentsType &getSegments() const;
 
         [[nodiscard]] Position position(double t) const;
 
+        /**
+         * \brief Checks if path has position at time t, i.e. position(t) doesn't throw
+         */
+        [[nodiscard]] inline bool covers(double t) const {
+            return !keys.empty() && t > 0 && t >= start_time && t <= keys.back();
+        }
+
+        /**
+         * \brief Position at time t or nothing if path doesn't cover t. Never throws.
+         */
+        [[nodiscard]] std::optional<Position> tryPosition(double t) const;
+
+        /**
+         * \brief Positions at several times. Never throws.
+         * @param times Times to sample, ascending order makes lookups amortized O(1)
+         * @param count Number of times
+         * @param result Destination of count elements, empty where path doesn't cover time
+         */
+        void sample(const double* times, size_t count, std::optional<Position>* result) const;
+
+        [[nodiscard]] std::vector<std::optional<Position>> sample(const std::vector<double>& times) const;
+
         [[nodiscard]] constItr segment(double t) const;
 
         [[nodiscard]] inline constItr end() const { return segments.cend(); }
@@ -137,6 +205,21 @@ namespace USV {
 
         [[nodiscard]] std::vector<Vector2> getPointsPath(double angle_increment=2.0/180*M_PI)const;
 
+        /**
+         * \brief Number of points returned by getPointsPath
+         */
+        [[nodiscard]] size_t pointsPathCount(double angle_increment = 2.0 / 180 * M_PI) const;
+
+        /**
+         * \brief Writes getPointsPath points as x, y floats without temporary vector, e.g. to mapped GL buffer
+         * @param out Destination of 2 * pointsPathCount(angle_increment) floats
+         */
+        void writePointsPath(float* out, double angle_increment = 2.0 / 180 * M_PI) const;
+
+    private:
+        template<typename Out>
+        void forEachPathPoint(double angle_increment, Out&& out) const;
+
     };
 
 }
@@ -1,5 +1,27 @@
 #include "Restrictions.h"
+#include "Parallel.h"
+#include "earcut.h"
 #include <algorithm>
+#include <emmintrin.h>
+#include <utility>
+
+namespace mapbox::util {
+
+    template<>
+    struct nth<0, USV::Vector2> {
+        inline static auto get(const USV::Vector2& t) {
+            return t.x();
+        };
+    };
+
+    template<>
+    struct nth<1, USV::Vector2> {
+        inline static auto get(const USV::Vector2& t) {
+            return t.y();
+        };
+    };
+
+} // namespace mapbox
 
 namespace USV::Restrictions {
     namespace {
@@ -8,6 +30,17 @@ namespace USV::Restrictions {
             return {tmp.y(),tmp.x()};
         }
 
+        /**
+         * Batch version of geoJSONToLocal
+         */
+        std::vector<Vector2> geoJSONToLocal(const std::vector<Vector2>& points, const USV::Frame& reference_frame) {
+            std::vector<Vector2> result(points.size());
+            reference_frame.fromGeoJSON(points.data(), points.size(), result.data());
+            for (auto& point: result)
+                point = {point.y(), point.x()};
+            return result;
+        }
+
         bool pointInRing(const ring_type& ring, const Vector2& point) {
             bool c = false;
             for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
@@ -20,16 +53,37 @@ namespace USV::Restrictions {
             return c;
         }
 
-        bool pointInPolygon(const Polygon& polygon, const Vector2& point) {
-            if (pointInRing(polygon.rings[0], point)) {
-                size_t c = 1;
-                for (size_t i = 1; i < polygon.rings.size(); ++i) {
-                    if (pointInRing(polygon.rings[i], point))
-                        ++c;
-                }
-                return c % 2 == 1;
-            }
-            return false;
+        double segmentDistanceSq(const Vector2& p, const Vector2& a, const Vector2& b) {
+            const auto ab = b - a;
+            const auto len_sq = absSq(ab);
+            const double t = len_sq > 0 ? std::clamp(((p - a) * ab) / len_sq, 0.0, 1.0) : 0.0;
+            return absSq(p - (a + t * ab));
+        }
+
+        inline double orientation(const Vector2& a, const Vector2& b, const Vector2& c) {
+            return det(b - a, c - a);
+        }
+
+        bool segmentsIntersect(const Vector2& a, const Vector2& b, const Vector2& c, const Vector2& d) {
+            const double d1 = orientation(c, d, a), d2 = orientation(c, d, b);
+            const double d3 = orientation(a, b, c), d4 = orientation(a, b, d);
+            if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+                return true;
+            auto on_segment = [](const Vector2& p, const Vector2& q, const Vector2& r) {
+                return Box(p, q).contains(r);
+            };
+            return (d1 == 0 && on_segment(c, d, a)) || (d2 == 0 && on_segment(c, d, b)) ||
+                   (d3 == 0 && on_segment(a, b, c)) || (d4 == 0 && on_segment(a, b, d));
+        }
+
+        /**
+         * Calls f(a, b) for every edge of line, closed if ring is true
+         */
+        template<typename F>
+        void forEachEdge(const std::vector<Vector2>& line, bool ring, F&& f) {
+            if (line.empty()) return;
+            for (size_t i = 1; i < line.size(); ++i) f(line[i - 1], line[i]);
+            if (ring && line.size() > 2) f(line.back(), line.front());
         }
 
         bool clockwiseRing(const ring_type& ring) {
@@ -45,86 +99,324 @@ namespace USV::Restrictions {
         }
     }
 
+    EdgeTable::EdgeTable(const ring_type& ring) : box(Box::of(ring)) {
+        // Fewer than 3 points enclose nothing, table is left empty
+        if (ring.size() < 3) return;
+        // Bands count: about 4 edges per band for evenly spread edges
+        const size_t bands = std::max<size_t>(1, std::min<size_t>(ring.size() / 4, 4096));
+        const double height = box.max_y - box.min_y;
+        band_scale = height > 0 ? static_cast<double>(bands) / height : 0;
+        auto band = [this, bands](double y) {
+            const double b = (y - box.min_y) * band_scale;
+            return b <= 0 ? size_t{0} : std::min(static_cast<size_t>(b), bands - 1);
+        };
+
+        // Counting pass, then fill
+        band_offsets.assign(bands + 1, 0);
+        forEachEdge(ring, true, [&](const Vector2& a, const Vector2& b) {
+            if (a.y() == b.y()) return;
+            for (size_t i = band(std::min(a.y(), b.y())), last = band(std::max(a.y(), b.y())); i <= last; ++i)
+                ++band_offsets[i + 1];
+        });
+        for (size_t i = 0; i < bands; ++i) band_offsets[i + 1] += band_offsets[i];
+        const auto total = band_offsets.back();
+        for (auto* v: {&y_low, &y_high, &x_low, &inv_slope}) v->resize(total);
+        std::vector<uint32_t> fill(band_offsets.begin(), band_offsets.end() - 1);
+        forEachEdge(ring, true, [&](const Vector2& a, const Vector2& b) {
+            if (a.y() == b.y()) return;
+            const auto& low = a.y() < b.y() ? a : b;
+            const auto& high = a.y() < b.y() ? b : a;
+            const double inv = (high.x() - low.x()) / (high.y() - low.y());
+            for (size_t i = band(low.y()), last = band(high.y()); i <= last; ++i) {
+                const auto k = fill[i]++;
+                y_low[k] = low.y();
+                y_high[k] = high.y();
+                x_low[k] = low.x();
+                inv_slope[k] = inv;
+            }
+        });
+    }
+
+    bool EdgeTable::contains(const Vector2& point) const {
+        const double px = point.x(), py = point.y();
+        // Crossings are counted to the right of the point
+        if (py < box.min_y || py >= box.max_y || px >= box.max_x || band_offsets.size() < 2) return false;
+        const size_t bands = band_offsets.size() - 1;
+        const auto band = std::min(static_cast<size_t>((py - box.min_y) * band_scale), bands - 1);
+        size_t k = band_offsets[band];
+        const size_t end = band_offsets[band + 1];
+        unsigned crossings = 0;
+        const __m128d x = _mm_set1_pd(px), y = _mm_set1_pd(py);
+        for (; k + 1 < end; k += 2) {
+            const __m128d lo = _mm_loadu_pd(&y_low[k]);
+            const __m128d hi = _mm_loadu_pd(&y_high[k]);
+            const __m128d x_cross = _mm_add_pd(_mm_loadu_pd(&x_low[k]),
+                                               _mm_mul_pd(_mm_sub_pd(y, lo), _mm_loadu_pd(&inv_slope[k])));
+            const __m128d mask = _mm_and_pd(_mm_and_pd(_mm_cmple_pd(lo, y), _mm_cmplt_pd(y, hi)),
+                                            _mm_cmplt_pd(x, x_cross));
+            const int bits = _mm_movemask_pd(mask);
+            crossings += static_cast<unsigned>((bits & 1) + (bits >> 1));
+        }
+        if (k < end && y_low[k] <= py && py < y_high[k] && px < x_low[k] + (py - y_low[k]) * inv_slope[k])
+            ++crossings;
+        return crossings & 1u;
+    }
+
+    void Polygon::buildEdgeTables() {
+        edge_tables.clear();
+        edge_tables.reserve(rings.size());
+        for (const auto& ring: rings) edge_tables.emplace_back(ring);
+    }
+
+    bool pointInPolygon(const Polygon& polygon, const Vector2& point) {
+        if (polygon.hasEdgeTables()) {
+            if (!polygon.edge_tables[0].contains(point)) return false;
+            size_t c = 1;
+            for (size_t i = 1; i < polygon.edge_tables.size(); ++i)
+                c += polygon.edge_tables[i].contains(point);
+            return c % 2 == 1;
+        }
+        if (pointInRing(polygon.rings[0], point)) {
+            size_t c = 1;
+            for (size_t i = 1; i < polygon.rings.size(); ++i) {
+                if (pointInRing(polygon.rings[i], point))
+                    ++c;
+            }
+            return c % 2 == 1;
+        }
+        return false;
+    }
+
+    std::vector<bool> containsPoints(const Polygon& polygon, const std::vector<Vector2>& points) {
+        std::vector<bool> result(points.size());
+        if (polygon.rings.empty()) return result;
+        std::vector<EdgeTable> temporary;
+        const std::vector<EdgeTable>* tables = &polygon.edge_tables;
+        if (!polygon.hasEdgeTables()) {
+            for (const auto& ring: polygon.rings) temporary.emplace_back(ring);
+            tables = &temporary;
+        }
+        const auto& outer = (*tables)[0];
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (!outer.contains(points[i])) continue;
+            size_t c = 1;
+            for (size_t r = 1; r < tables->size(); ++r)
+                c += (*tables)[r].contains(points[i]);
+            result[i] = c % 2 == 1;
+        }
+        return result;
+    }
+
+    namespace {
+        // Access to geometry behind LimitationRef
+        const Limitations& limitations(const Restrictions& restrictions, const LimitationRef& ref) {
+            return ref.hard ? restrictions.hard : restrictions.soft;
+        }
+
+        const Polygon* polygon(const Restrictions& restrictions, const LimitationRef& ref) {
+            const auto& l = limitations(restrictions, ref);
+            switch (ref.kind) {
+                case LimitationRef::Kind::ZoneEnteringProhibition:
+                    return &l.ZoneEnteringProhibitions()[ref.index].polygon;
+                case LimitationRef::Kind::ZoneLeavingProhibition:
+                    return &l.ZoneLeavingProhibitions()[ref.index].polygon;
+                case LimitationRef::Kind::MovementParametersLimitation:
+                    return &l.MovementParametersLimitations()[ref.index].polygon;
+                default:
+                    return nullptr;
+            }
+        }
+    }
+
     LineString lineToLocal(const std::vector<Vector2>& line, const USV::Frame& reference_frame) {
-        LineString linestring;
-        linestring.reserve(line.size());
-        for (auto& point: line)
-            linestring.push_back(geoJSONToLocal(point, reference_frame));
-        return linestring;
+        return geoJSONToLocal(line, reference_frame);
     }
 
     Polygon polygonToLocal(const std::vector<std::vector<Vector2>>& polygon, const Frame& frame) {
         Polygon poly;
         poly.rings.reserve(polygon.size());
         for (const auto& itr : polygon) {
-            poly.rings.emplace_back(0);
-            auto& ring = poly.rings.back();
-            ring.reserve(itr.size());
-            for (auto& point: itr)
-                ring.push_back(geoJSONToLocal(point, frame));
-            ring.pop_back();
+            poly.rings.push_back(geoJSONToLocal(itr, frame));
+            poly.rings.back().pop_back();
         }
         if (clockwiseRing(poly.rings[0]))
             std::reverse(poly.rings[0].begin(), poly.rings[0].end());
+        poly.buildEdgeTables();
+        poly.triangles = triangulate(poly);
         return poly;
     }
 
+    std::vector<uint32_t> triangulate(const Polygon& polygon) {
+        return mapbox::earcut<uint32_t>(polygon.rings);
+    }
+
     USV::Restrictions::Restrictions::Restrictions(const USV::FeatureCollection& feature_collection,
                                                   const USV::Frame& reference_frame) {
-        for (const auto& feature:feature_collection.features) {
+        // Project geometry of features in parallel, then classify them in features order
+        struct Projected {
+            Vector2 point;
+            LineString line;
+            Polygon polygon;
+        };
+        const auto& features = feature_collection.features;
+        std::vector<Projected> projected(features.size());
+        Parallel::parallelFor(features.size(), [&](size_t i) {
+            const auto& geometry = features[i].geometry;
+            auto& p = projected[i];
+            switch (features[i].properties.limitation_type) {
+                case LimitationType::point_approach_prohibition:
+                    p.point = geoJSONToLocal(geometry.coordinatesPoint, reference_frame);
+                    break;
+                case LimitationType::line_crossing_prohibition:
+                    p.line = lineToLocal(geometry.coordinatesLine, reference_frame);
+                    break;
+                case LimitationType::zone_entering_prohibition:
+                case LimitationType::zone_leaving_prohibition:
+                case LimitationType::movement_parameters_limitation:
+                    p.polygon = polygonToLocal(geometry.coordinatesPolygon, reference_frame);
+                    break;
+            }
+        }, 16);
+
+        for (size_t i = 0; i < features.size(); ++i) {
+            const auto& feature = features[i];
+            auto& p = projected[i];
             properties.push_back(feature.properties);
             auto& proper = feature.properties.hardness == RestrictionType::Soft ? soft : hard;
             switch (feature.properties.limitation_type) {
-                case LimitationType::point_approach_prohibition: {
-                    auto point = geoJSONToLocal(feature.geometry.coordinatesPoint, reference_frame);
-                    proper.add_point_approach_prohibition(point, &properties.back());
-                }
+                case LimitationType::point_approach_prohibition:
+                    proper.add_point_approach_prohibition(p.point, &properties.back());
                     break;
-                case LimitationType::line_crossing_prohibition: {
-                    auto line = lineToLocal(feature.geometry.coordinatesLine, reference_frame);
-                    proper.add_line_crossing_prohibition(line, &properties.back());
-                }
+                case LimitationType::line_crossing_prohibition:
+                    proper.add_line_crossing_prohibition(std::move(p.line), &properties.back());
                     break;
-                case LimitationType::zone_entering_prohibition: {
-                    Polygon poly = polygonToLocal(feature.geometry.coordinatesPolygon, reference_frame);
+                case LimitationType::zone_entering_prohibition:
                     // Check if we within outer ring
-                    proper.add_zone_entering_prohibition(poly, &properties.back());
-                }
+                    proper.add_zone_entering_prohibition(std::move(p.polygon), &properties.back());
                     break;
-                case LimitationType::zone_leaving_prohibition: {
-                    Polygon poly = polygonToLocal(feature.geometry.coordinatesPolygon, reference_frame);
+                case LimitationType::zone_leaving_prohibition:
                     // Add only zones where we are already
-                    proper.add_zone_leaving_prohibition(poly, &properties.back());
-                }
+                    proper.add_zone_leaving_prohibition(std::move(p.polygon), &properties.back());
                     break;
-                case LimitationType::movement_parameters_limitation: {
-                    Polygon poly = polygonToLocal(feature.geometry.coordinatesPolygon, reference_frame);
-                    proper.add_movement_parameters_limitation(poly, &properties.back());
-                }
+                case LimitationType::movement_parameters_limitation:
+                    proper.add_movement_parameters_limitation(std::move(p.polygon), &properties.back());
                     break;
             }
         }
+        buildIndex();
+    }
+
+    void Restrictions::buildIndex() {
+        index_items.clear();
+        std::vector<Box> boxes;
+        for (bool is_hard: {true, false}) {
+            const auto& l = is_hard ? hard : soft;
+            auto add = [&](LimitationRef::Kind kind, size_t i, const Box& box) {
+                index_items.push_back({is_hard, kind, i});
+                boxes.push_back(box);
+            };
+            for (size_t i = 0; i < l.PointApproachProhibitions().size(); ++i) {
+                const auto& p = l.PointApproachProhibitions()[i].point;
+                add(LimitationRef::Kind::PointApproachProhibition, i, Box(p, p));
+            }
+            for (size_t i = 0; i < l.LineCrossingProhibitions().size(); ++i)
+                add(LimitationRef::Kind::LineCrossingProhibition, i, Box::of(l.LineCrossingProhibitions()[i].linestring));
+            for (size_t i = 0; i < l.ZoneEnteringProhibitions().size(); ++i)
+                add(LimitationRef::Kind::ZoneEnteringProhibition, i,
+                    Box::of(l.ZoneEnteringProhibitions()[i].polygon.rings[0]));
+            for (size_t i = 0; i < l.ZoneLeavingProhibitions().size(); ++i)
+                add(LimitationRef::Kind::ZoneLeavingProhibition, i,
+                    Box::of(l.ZoneLeavingProhibitions()[i].polygon.rings[0]));
+            for (size_t i = 0; i < l.MovementParametersLimitations().size(); ++i)
+                add(LimitationRef::Kind::MovementParametersLimitation, i,
+                    Box::of(l.MovementParametersLimitations()[i].polygon.rings[0]));
+        }
+        index = SpatialIndex(boxes);
+    }
+
+    std::vector<LimitationRef> Restrictions::zonesAt(const Vector2& point) const {
+        std::vector<LimitationRef> result;
+        index.query(point, [&](uint32_t id) {
+            const auto& ref = index_items[id];
+            const auto* poly = polygon(*this, ref);
+            if (poly && pointInPolygon(*poly, point)) result.push_back(ref);
+        });
+        return result;
+    }
+
+    std::vector<LimitationRef> Restrictions::intersecting(const Vector2& a, const Vector2& b) const {
+        std::vector<LimitationRef> result;
+        index.query(Box(a, b), [&](uint32_t id) {
+            const auto& ref = index_items[id];
+            bool hit = false;
+            auto test_edge = [&](const Vector2& c, const Vector2& d) {
+                hit = hit || segmentsIntersect(a, b, c, d);
+            };
+            if (const auto* poly = polygon(*this, ref)) {
+                hit = pointInPolygon(*poly, a);
+                for (const auto& ring: poly->rings) forEachEdge(ring, true, test_edge);
+            } else if (ref.kind == LimitationRef::Kind::LineCrossingProhibition) {
+                forEachEdge(limitations(*this, ref).LineCrossingProhibitions()[ref.index].linestring, false, test_edge);
+            }
+            if (hit) result.push_back(ref);
+        });
+        return result;
+    }
+
+    double Restrictions::distance(const LimitationRef& ref, const Vector2& point) const {
+        double d = std::numeric_limits<double>::infinity();
+        auto edge_distance = [&](const Vector2& a, const Vector2& b) {
+            d = std::min(d, segmentDistanceSq(point, a, b));
+        };
+        if (const auto* poly = polygon(*this, ref)) {
+            if (pointInPolygon(*poly, point)) return 0;
+            for (const auto& ring: poly->rings) forEachEdge(ring, true, edge_distance);
+        } else if (ref.kind == LimitationRef::Kind::LineCrossingProhibition) {
+            const auto& line = limitations(*this, ref).LineCrossingProhibitions()[ref.index].linestring;
+            if (line.size() == 1) d = absSq(line[0] - point);
+            forEachEdge(line, false, edge_distance);
+        } else {
+            d = absSq(limitations(*this, ref).PointApproachProhibitions()[ref.index].point - point);
+        }
+        return std::sqrt(d);
+    }
+
+    std::optional<std::pair<LimitationRef, double>> Restrictions::nearest(const Vector2& point) const {
+        const auto[id, d] = index.nearest(point, [this](uint32_t id, const Vector2& p) {
+            return distance(index_items[id], p);
+        });
+        if (id >= index_items.size()) return std::nullopt;
+        return std::make_pair(index_items[id], d);
+    }
+
+    std::vector<LimitationRef> Restrictions::inBox(const Box& box) const {
+        std::vector<LimitationRef> result;
+        index.query(box, [&](uint32_t id) { result.push_back(index_items[id]); });
+        return result;
     }
 
     void Limitations::add_point_approach_prohibition(Vector2 point, FeatureProperties* features_ptr) {
         point_approach_prohibitions.push_back({point, features_ptr});
     }
 
-    void Limitations::add_line_crossing_prohibition(LineString& linestring, FeatureProperties* features_ptr) {
-        line_crossing_prohibitions.push_back({linestring, features_ptr});
+    void Limitations::add_line_crossing_prohibition(LineString linestring, FeatureProperties* features_ptr) {
+        line_crossing_prohibitions.push_back({std::move(linestring), features_ptr});
     }
 
-    void Limitations::add_zone_entering_prohibition(Polygon& polygon, FeatureProperties* features_ptr) {
+    void Limitations::add_zone_entering_prohibition(Polygon polygon, FeatureProperties* features_ptr) {
+        if (!polygon.hasEdgeTables()) polygon.buildEdgeTables();
         if (!pointInPolygon(polygon, {0, 0}))
-            zone_entering_prohibitions.push_back({polygon, features_ptr});
+            zone_entering_prohibitions.push_back({std::move(polygon), features_ptr});
     }
 
-    void Limitations::add_zone_leaving_prohibition(Polygon& polygon, FeatureProperties* features_ptr) {
+    void Limitations::add_zone_leaving_prohibition(Polygon polygon, FeatureProperties* features_ptr) {
+        if (!polygon.hasEdgeTables()) polygon.buildEdgeTables();
         if (pointInPolygon(polygon, {0, 0}))
-            zone_leaving_prohibitions.push_back({polygon, features_ptr});
+            zone_leaving_prohibitions.push_back({std::move(polygon), features_ptr});
     }
 
-    void Limitations::add_movement_parameters_limitation(Polygon& polygon, FeatureProperties* features_ptr) {
-        movement_parameters_limitations.push_back({polygon, features_ptr});
+    void Limitations::add_movement_parameters_limitation(Polygon polygon, FeatureProperties* features_ptr) {
+        if (!polygon.hasEdgeTables()) polygon.buildEdgeTables();
+        movement_parameters_limitations.push_back({std::move(polygon), features_ptr});
     }
 }
@@ -4,16 +4,52 @@
 #include "Vector2.h"
 #include "Frame.h"
 #include "FeatureCollection.h"
+#include "SpatialIndex.h"
 #include <vector>
 #include <deque>
+#include <optional>
 
 namespace USV::Restrictions {
 
     typedef std::vector<Vector2> LineString;
     typedef std::vector<Vector2> ring_type;
 
+    /**
+     * \brief Precomputed edges of a ring for point-in-ring tests.
+     *
+     * Non-horizontal edges are stored as lower y, upper y, x at lower y and inverse slope,
+     * so the crossing test of a horizontal ray needs no division. Edges are bucketed by
+     * y into bands, an edge is stored in every band it spans, so a point is tested only
+     * against edges of its band.
+     */
+    struct EdgeTable {
+        Box box;
+        double band_scale{0}; //! Bands per unit of y
+        std::vector<uint32_t> band_offsets; //! Edges of band i are [band_offsets[i], band_offsets[i + 1])
+        std::vector<double> y_low, y_high, x_low, inv_slope;
+
+        EdgeTable() = default;
+
+        explicit EdgeTable(const ring_type& ring);
+
+        /**
+         * \brief Even-odd test, same rule as for rings without table
+         */
+        [[nodiscard]] bool contains(const Vector2& point) const;
+    };
+
     struct Polygon {
         std::vector<ring_type> rings;
+        //! Parallel to rings, built by buildEdgeTables(). Rebuild after modifying rings.
+        std::vector<EdgeTable> edge_tables{};
+        //! Triangles as triples of indices to points of concatenated rings, filled by polygonToLocal()
+        std::vector<uint32_t> triangles{};
+
+        void buildEdgeTables();
+
+        [[nodiscard]] inline bool hasEdgeTables() const {
+            return !rings.empty() && edge_tables.size() == rings.size();
+        }
     };
 
     class Limitations {
@@ -52,13 +88,13 @@ namespace USV::Restrictions {
 
         void add_point_approach_prohibition(Vector2 point, FeatureProperties*);
 
-        void add_line_crossing_prohibition(LineString& linestring, FeatureProperties*);
+        void add_line_crossing_prohibition(LineString linestring, FeatureProperties*);
 
-        void add_zone_entering_prohibition(Polygon& polygon, FeatureProperties*);
+        void add_zone_entering_prohibition(Polygon polygon, FeatureProperties*);
 
-        void add_zone_leaving_prohibition(Polygon& polygon, FeatureProperties*);
+        void add_zone_leaving_prohibition(Polygon polygon, FeatureProperties*);
 
-        void add_movement_parameters_limitation(Polygon& polygon, FeatureProperties* features_ptr);
+        void add_movement_parameters_limitation(Polygon polygon, FeatureProperties* features_ptr);
 
         [[nodiscard]] const std::vector<Limitation::point_approach_prohibition>& PointApproachProhibitions() const {
             return point_approach_prohibitions;
@@ -86,6 +122,22 @@ namespace USV::Restrictions {
         }
     };
 
+    /**
+     * \brief Reference to a limitation stored in Restrictions
+     */
+    struct LimitationRef {
+        enum class Kind {
+            PointApproachProhibition,
+            LineCrossingProhibition,
+            ZoneEnteringProhibition,
+            ZoneLeavingProhibition,
+            MovementParametersLimitation
+        };
+        bool hard;
+        Kind kind;
+        size_t index; //! Index in the corresponding Limitations vector
+    };
+
     struct Restrictions {
         Limitations hard;
         Limitations soft;
@@ -101,13 +153,65 @@ namespace USV::Restrictions {
             return hard.empty() && soft.empty();
         }
 
+        /**
+         * \brief Rebuilds spatial index over hard and soft limitations. Called by the constructor,
+         *        call again after modifying hard or soft.
+         */
+        void buildIndex();
+
+        /**
+         * \brief Zones (zone entering/leaving prohibitions and movement parameters limitations) containing point
+         */
+        [[nodiscard]] std::vector<LimitationRef> zonesAt(const Vector2& point) const;
+
+        /**
+         * \brief Zones and lines intersected by segment [a, b]. Zone is intersected if segment
+         *        crosses its boundary or lies inside it.
+         */
+        [[nodiscard]] std::vector<LimitationRef> intersecting(const Vector2& a, const Vector2& b) const;
+
+        /**
+         * \brief Limitation nearest to point and distance to it. Distance to zone containing point is 0.
+         */
+        [[nodiscard]] std::optional<std::pair<LimitationRef, double>> nearest(const Vector2& point) const;
+
+        /**
+         * \brief Limitations with bounding box intersecting box, e.g. visible in viewport
+         */
+        [[nodiscard]] std::vector<LimitationRef> inBox(const Box& box) const;
+
+        /**
+         * \brief Exact distance from point to limitation, 0 inside zone
+         */
+        [[nodiscard]] double distance(const LimitationRef& ref, const Vector2& point) const;
 
+    private:
+        SpatialIndex index{};
+        std::vector<LimitationRef> index_items{};
     };
 
     Polygon polygonToLocal(const std::vector<std::vector<Vector2>>& polygon, const Frame& frame);
 
+    /**
+     * \brief Triangulates polygon with holes (earcut)
+     * @return Triples of indices to points of concatenated rings
+     */
+    std::vector<uint32_t> triangulate(const Polygon& polygon);
+
     LineString lineToLocal(const std::vector<Vector2>& line, const USV::Frame& reference_frame);
 
+    /**
+     * \brief Even-odd test of point against polygon with holes
+     */
+    bool pointInPolygon(const Polygon& polygon, const Vector2& point);
+
+    /**
+     * \brief Even-odd test of many points against polygon with holes.
+     *        Uses edge tables of polygon, building temporary ones if polygon has none.
+     * @return result[i] is true if points[i] is inside
+     */
+    std::vector<bool> containsPoints(const Polygon& polygon, const std::vector<Vector2>& points);
+
 }
 
 #endif //USV_GUI_RESTRICTIONS_H
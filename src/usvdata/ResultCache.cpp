@@ -0,0 +1,154 @@
+#include "ResultCache.h"
+#include "CacheDirectory.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace USV::ResultCache {
+    namespace {
+        namespace fs = std::filesystem;
+
+        // Bump when key or entry layout changes
+        constexpr uint32_t cache_version = 1;
+        constexpr const char* log_entry_filename = "solver.log";
+
+        fs::path find_executable(const fs::path& executable) {
+            std::error_code ec;
+            if (executable.has_parent_path() || fs::is_regular_file(executable, ec)) return executable;
+            // Bare name, spawned through PATH lookup
+            const char* env_path = std::getenv("PATH");
+            if (!env_path) return {};
+#ifdef _WIN32
+            const char separator = ';';
+#else
+            const char separator = ':';
+#endif
+            std::istringstream dirs(env_path);
+            for (std::string dir; std::getline(dirs, dir, separator);) {
+                if (dir.empty()) continue;
+                auto candidate = fs::path(dir) / executable;
+                if (fs::is_regular_file(candidate, ec)) return candidate;
+#ifdef _WIN32
+                candidate += ".exe";
+                if (fs::is_regular_file(candidate, ec)) return candidate;
+#endif
+            }
+            return {};
+        }
+
+        /**
+         * Hash of executable contents. Solver binaries are tens of megabytes and batch runs
+         * start them thousands of times, so hashes are remembered while size and mtime hold.
+         */
+        std::optional<uint64_t> executable_hash(const fs::path& executable) {
+            static std::mutex mutex;
+            static std::map<std::tuple<fs::path, uintmax_t, fs::file_time_type>, uint64_t> hashes;
+
+            const auto path = find_executable(executable);
+            std::error_code ec;
+            if (path.empty()) return std::nullopt;
+            const auto canonical = fs::canonical(path, ec);
+            if (ec) return std::nullopt;
+            const auto size = fs::file_size(canonical, ec);
+            if (ec) return std::nullopt;
+            const auto mtime = fs::last_write_time(canonical, ec);
+            if (ec) return std::nullopt;
+            const auto id = std::make_tuple(canonical, size, mtime);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const auto it = hashes.find(id);
+                if (it != hashes.end()) return it->second;
+            }
+            MappedFile file(canonical);
+            const auto hash = fnv1a(file.data(), file.size());
+            std::lock_guard<std::mutex> lock(mutex);
+            hashes[id] = hash;
+            return hash;
+        }
+
+        std::string entry_name(uint64_t key) {
+            char name[17];
+            snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+            return name;
+        }
+
+        // Outputs are stored under their flag, case naming conventions differ
+        std::string output_entry_filename(const FileArgument& output) {
+            auto name = output.flag;
+            while (!name.empty() && name.front() == '-') name.erase(name.begin());
+            return name + ".json";
+        }
+    }
+
+    fs::path defaultDirectory() {
+        return cacheDirectory("USV_GUI_RESULT_CACHE", "results");
+    }
+
+    std::optional<uint64_t> key(const fs::path& executable, const std::vector<FileArgument>& inputs) {
+        const auto executable_key = executable_hash(executable);
+        if (!executable_key) return std::nullopt;
+        uint64_t key = fnv1a(&cache_version, sizeof(cache_version));
+        key = fnv1a(&*executable_key, sizeof(*executable_key), key);
+        for (const auto& input: inputs) {
+            key = fnv1a(input.flag, key);
+            std::error_code ec;
+            if (!fs::is_regular_file(input.path, ec)) {
+                key = fnv1a(std::string_view("<missing>"), key);
+                continue;
+            }
+            MappedFile file(input.path);
+            const uint64_t size = file.size();
+            key = fnv1a(&size, sizeof(size), key);
+            key = fnv1a(file.data(), file.size(), key);
+        }
+        return key;
+    }
+
+    bool restore(const fs::path& directory, uint64_t key, const std::vector<FileArgument>& outputs,
+                 std::string& log) {
+        const auto entry = directory / entry_name(key);
+        std::error_code ec;
+        if (!fs::is_directory(entry, ec)) return false;
+        for (const auto& output: outputs) {
+            const auto cached = entry / output_entry_filename(output);
+            if (fs::is_regular_file(cached, ec))
+                fs::copy_file(cached, output.path, fs::copy_options::overwrite_existing);
+        }
+        std::ifstream ifs(entry / log_entry_filename, std::ios::binary);
+        log.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    void store(const fs::path& directory, uint64_t key, const std::vector<FileArgument>& outputs,
+               const std::string& log) {
+        const auto entry = directory / entry_name(key);
+        std::error_code ec;
+        if (fs::is_directory(entry, ec)) return;
+        fs::create_directories(directory);
+
+        // Concurrent runs of the same inputs write their own temporary entries, first rename wins
+        const auto tmp = temporaryPath(entry);
+        fs::create_directory(tmp);
+        try {
+            for (const auto& output: outputs)
+                fs::copy_file(output.path, tmp / output_entry_filename(output));
+            std::ofstream ofs(tmp / log_entry_filename, std::ios::binary);
+            ofs.write(log.data(), static_cast<std::streamsize>(log.size()));
+            if (!ofs.good()) throw std::runtime_error("Failed to write " + (tmp / log_entry_filename).string());
+        } catch (...) {
+            fs::remove_all(tmp, ec);
+            throw;
+        }
+        fs::rename(tmp, entry, ec);
+        if (ec) fs::remove_all(tmp, ec);
+    }
+}
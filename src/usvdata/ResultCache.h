@@ -0,0 +1,52 @@
+#ifndef USV_RESULTCACHE_H
+#define USV_RESULTCACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * \file       ResultCache.h
+ * \brief      Content addressed store of solver outputs. Entry key is hash of solver executable
+ *             and of every input file with its command line flag; entry is a directory holding
+ *             output files and solver log.
+ */
+namespace USV::ResultCache {
+    //! Solver command line argument naming a file
+    struct FileArgument {
+        std::string flag;
+        std::filesystem::path path;
+    };
+
+    /**
+     * \brief Cache location: USV_GUI_RESULT_CACHE environment variable, else usv-gui/results in
+     *        user cache directory. Empty if cache is disabled (variable set to "off" or empty).
+     */
+    std::filesystem::path defaultDirectory();
+
+    /**
+     * \brief Key of solver run. Missing inputs are hashed as such.
+     * @return Nothing if executable can't be found, so its identity is unknown
+     */
+    std::optional<uint64_t> key(const std::filesystem::path& executable, const std::vector<FileArgument>& inputs);
+
+    /**
+     * \brief Copies cached outputs of key to their paths. Outputs absent from entry are left as they are.
+     * @param log Receives stored solver log
+     * @return false if there's no entry
+     */
+    bool restore(const std::filesystem::path& directory, uint64_t key, const std::vector<FileArgument>& outputs,
+                 std::string& log);
+
+    /**
+     * \brief Stores outputs and solver log as entry of key. Entry is made visible atomically,
+     *        existing entry is kept.
+     * @throws std::filesystem::filesystem_error, std::runtime_error
+     */
+    void store(const std::filesystem::path& directory, uint64_t key, const std::vector<FileArgument>& outputs,
+               const std::string& log);
+}
+
+#endif //USV_RESULTCACHE_H
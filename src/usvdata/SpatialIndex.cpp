@@ -0,0 +1,73 @@
+#include "SpatialIndex.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace USV {
+    SpatialIndex::SpatialIndex(const std::vector<Box>& items, size_t node_size) :
+            node_size(std::max<size_t>(node_size, 2)), item_count(items.size()) {
+        if (items.empty()) return;
+
+        // Sort-Tile-Recursive order of items: vertical slices by x, sorted by y within slice
+        std::vector<uint32_t> order(items.size());
+        std::iota(order.begin(), order.end(), 0);
+        const auto leaves = (items.size() + this->node_size - 1) / this->node_size;
+        const auto slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+        const auto slice_size = slices * this->node_size;
+        std::sort(order.begin(), order.end(), [&items](uint32_t a, uint32_t b) {
+            return items[a].center().x() < items[b].center().x();
+        });
+        for (size_t begin = 0; begin < order.size(); begin += slice_size) {
+            const auto end = std::min(begin + slice_size, order.size());
+            std::sort(order.begin() + static_cast<std::ptrdiff_t>(begin), order.begin() + static_cast<std::ptrdiff_t>(end),
+                      [&items](uint32_t a, uint32_t b) {
+                          return items[a].center().y() < items[b].center().y();
+                      });
+        }
+
+        boxes.reserve(items.size() * this->node_size / (this->node_size - 1) + 1);
+        indices.reserve(boxes.capacity());
+        for (auto id: order) {
+            boxes.push_back(items[id]);
+            indices.push_back(id);
+        }
+        level_bounds.push_back(boxes.size());
+
+        // Pack levels until single root
+        size_t level_begin = 0;
+        while (boxes.size() - level_begin > 1) {
+            const auto level_end = boxes.size();
+            for (size_t child = level_begin; child < level_end; child += this->node_size) {
+                Box box;
+                for (size_t i = child, end = std::min(child + this->node_size, level_end); i < end; ++i)
+                    box.expand(boxes[i]);
+                boxes.push_back(box);
+                indices.push_back(static_cast<uint32_t>(child));
+            }
+            level_begin = level_end;
+            level_bounds.push_back(boxes.size());
+        }
+    }
+
+    PointGrid::PointGrid(std::vector<Vector2> positions, double cell_size) :
+            cell_size(cell_size), points(std::move(positions)) {
+        if (!(cell_size > 0) || points.empty()) {
+            points.clear();
+            return;
+        }
+        std::vector<std::pair<uint64_t, uint32_t>> keyed;
+        keyed.reserve(points.size());
+        for (size_t i = 0; i < points.size(); ++i)
+            keyed.emplace_back(key(static_cast<int64_t>(std::floor(points[i].x() / cell_size)),
+                                   static_cast<int64_t>(std::floor(points[i].y() / cell_size))),
+                               static_cast<uint32_t>(i));
+        std::sort(keyed.begin(), keyed.end());
+        order.reserve(keyed.size());
+        for (size_t i = 0; i < keyed.size(); ++i) {
+            order.push_back(keyed[i].second);
+            if (i == 0 || keyed[i].first != keyed[i - 1].first)
+                cells.emplace(keyed[i].first, std::pair<uint32_t, uint32_t>(static_cast<uint32_t>(i), 0));
+            cells[keyed[i].first].second = static_cast<uint32_t>(i + 1);
+        }
+    }
+}
@@ -0,0 +1,241 @@
+#ifndef USV_SPATIALINDEX_H
+#define USV_SPATIALINDEX_H
+
+#include "Vector2.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace USV {
+    /**
+     * \brief      Axis-aligned bounding box. Default constructed box is empty.
+     */
+    struct Box {
+        double min_x{std::numeric_limits<double>::infinity()};
+        double min_y{std::numeric_limits<double>::infinity()};
+        double max_x{-std::numeric_limits<double>::infinity()};
+        double max_y{-std::numeric_limits<double>::infinity()};
+
+        Box() = default;
+
+        Box(double min_x, double min_y, double max_x, double max_y) :
+                min_x(min_x), min_y(min_y), max_x(max_x), max_y(max_y) {}
+
+        Box(const Vector2& a, const Vector2& b) :
+                min_x(std::min(a.x(), b.x())), min_y(std::min(a.y(), b.y())),
+                max_x(std::max(a.x(), b.x())), max_y(std::max(a.y(), b.y())) {}
+
+        template<typename Container>
+        static Box of(const Container& points) {
+            Box box;
+            for (const auto& p: points) box.expand(p);
+            return box;
+        }
+
+        inline void expand(const Vector2& p) {
+            min_x = std::min(min_x, p.x());
+            min_y = std::min(min_y, p.y());
+            max_x = std::max(max_x, p.x());
+            max_y = std::max(max_y, p.y());
+        }
+
+        inline void expand(const Box& b) {
+            min_x = std::min(min_x, b.min_x);
+            min_y = std::min(min_y, b.min_y);
+            max_x = std::max(max_x, b.max_x);
+            max_y = std::max(max_y, b.max_y);
+        }
+
+        [[nodiscard]] inline bool intersects(const Box& b) const {
+            return min_x <= b.max_x && b.min_x <= max_x && min_y <= b.max_y && b.min_y <= max_y;
+        }
+
+        [[nodiscard]] inline bool contains(const Vector2& p) const {
+            return min_x <= p.x() && p.x() <= max_x && min_y <= p.y() && p.y() <= max_y;
+        }
+
+        /**
+         * \brief Squared distance from point to box, 0 if point is inside
+         */
+        [[nodiscard]] inline double distanceSq(const Vector2& p) const {
+            const double dx = std::max({min_x - p.x(), 0.0, p.x() - max_x});
+            const double dy = std::max({min_y - p.y(), 0.0, p.y() - max_y});
+            return dx * dx + dy * dy;
+        }
+
+        [[nodiscard]] inline Vector2 center() const {
+            return {(min_x + max_x) * 0.5, (min_y + max_y) * 0.5};
+        }
+    };
+
+    /**
+     * \brief      Static packed R-tree over bounding boxes (Sort-Tile-Recursive bulk loading).
+     *
+     * Items are identified by their index in the array passed to constructor. Nodes of all
+     * levels are stored in one flat array: items in STR order first, root last.
+     */
+    class SpatialIndex {
+    public:
+        SpatialIndex() = default;
+
+        explicit SpatialIndex(const std::vector<Box>& items, size_t node_size = 16);
+
+        [[nodiscard]] inline size_t size() const { return item_count; }
+
+        [[nodiscard]] inline bool empty() const { return item_count == 0; }
+
+        /**
+         * \brief Calls visitor(id) for every item whose box intersects box.
+         *        Visitor may return false to stop the search.
+         */
+        template<typename Visitor>
+        void query(const Box& box, Visitor&& visitor) const {
+            search([&box](const Box& node) { return node.intersects(box); }, visitor);
+        }
+
+        /**
+         * \brief Calls visitor(id) for every item whose box contains point
+         */
+        template<typename Visitor>
+        void query(const Vector2& point, Visitor&& visitor) const {
+            search([&point](const Box& node) { return node.contains(point); }, visitor);
+        }
+
+        /**
+         * \brief Generic depth-first search
+         * @param predicate predicate(box), descends into nodes and reports items it accepts
+         * @param visitor visitor(id), may return false to stop the search
+         */
+        template<typename Predicate, typename Visitor>
+        void search(Predicate&& predicate, Visitor&& visitor) const {
+            if (boxes.empty()) return;
+            std::vector<size_t> stack{boxes.size() - 1};
+            while (!stack.empty()) {
+                const auto node = stack.back();
+                stack.pop_back();
+                if (!predicate(boxes[node])) continue;
+                if (node < item_count) {
+                    if constexpr (std::is_same_v<decltype(visitor(indices[node])), bool>) {
+                        if (!visitor(indices[node])) return;
+                    } else {
+                        visitor(indices[node]);
+                    }
+                    continue;
+                }
+                for (size_t child = indices[node], end = childrenEnd(child); child < end; ++child)
+                    stack.push_back(child);
+            }
+        }
+
+        /**
+         * \brief Best-first nearest item search
+         * @param point Query point
+         * @param distance distance(id, point) exact distance to item, not less than distance to its box
+         * @param max_distance Items farther away are ignored
+         * @return Nearest item id and distance to it, id is size() if there is no item within max_distance
+         */
+        template<typename Distance>
+        [[nodiscard]] std::pair<size_t, double> nearest(const Vector2& point, Distance&& distance,
+                                                        double max_distance = std::numeric_limits<double>::infinity()) const {
+            // (squared distance lower bound, node), items with exact distance are marked by node >= boxes.size()
+            using Entry = std::pair<double, size_t>;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+            if (!boxes.empty()) queue.emplace(boxes.back().distanceSq(point), boxes.size() - 1);
+            const double max_distance_sq = max_distance * max_distance;
+            while (!queue.empty()) {
+                const auto [d, node] = queue.top();
+                queue.pop();
+                if (d > max_distance_sq) break;
+                if (node >= boxes.size()) return {indices[node - boxes.size()], std::sqrt(d)};
+                if (node < item_count) {
+                    const double exact = distance(indices[node], point);
+                    queue.emplace(exact * exact, node + boxes.size());
+                    continue;
+                }
+                for (size_t child = indices[node], end = childrenEnd(child); child < end; ++child)
+                    queue.emplace(boxes[child].distanceSq(point), child);
+            }
+            return {item_count, std::numeric_limits<double>::infinity()};
+        }
+
+    private:
+        size_t node_size{16};
+        size_t item_count{0};
+        //! Items in STR order followed by nodes level by level
+        std::vector<Box> boxes;
+        //! Item id for items, first child for nodes
+        std::vector<uint32_t> indices;
+        //! End of each level in boxes
+        std::vector<size_t> level_bounds;
+
+        [[nodiscard]] inline size_t childrenEnd(size_t first_child) const {
+            const auto level_end = *std::upper_bound(level_bounds.begin(), level_bounds.end(), first_child);
+            return std::min(first_child + node_size, level_end);
+        }
+    };
+
+    /**
+     * \brief      Uniform grid hashing of points. Cell size is the search radius, so neighbours
+     *             of a point lie in its cell and the 8 around it.
+     */
+    class PointGrid {
+    public:
+        PointGrid() = default;
+
+        /**
+         * @param cell_size Search radius, grid is empty if it isn't positive
+         */
+        PointGrid(std::vector<Vector2> points, double cell_size);
+
+        [[nodiscard]] inline size_t size() const { return points.size(); }
+
+        /**
+         * \brief Calls visitor(i, j), i < j, once for every pair of points not farther than
+         *        cell size apart. Indices are of points passed to constructor.
+         */
+        template<typename Visitor>
+        void forEachPair(Visitor&& visitor) const {
+            const double radius_sq = cell_size * cell_size;
+            // Pairs within a cell, then with 4 of the neighbour cells so each pair of cells is seen once
+            constexpr int64_t forward[4][2] = {{1, -1}, {1, 0}, {1, 1}, {0, 1}};
+            for (const auto& [cell, range]: cells) {
+                for (auto a = range.first; a < range.second; ++a) {
+                    const auto i = order[a];
+                    for (auto b = a + 1; b < range.second; ++b)
+                        if (absSq(points[i] - points[order[b]]) <= radius_sq)
+                            visitor(std::min(i, order[b]), std::max(i, order[b]));
+                }
+                const auto cx = static_cast<int32_t>(cell >> 32u), cy = static_cast<int32_t>(cell & 0xFFFFFFFFu);
+                for (const auto& offset: forward) {
+                    const auto neighbour = cells.find(key(cx + offset[0], cy + offset[1]));
+                    if (neighbour == cells.end()) continue;
+                    for (auto a = range.first; a < range.second; ++a)
+                        for (auto b = neighbour->second.first; b < neighbour->second.second; ++b)
+                            if (absSq(points[order[a]] - points[order[b]]) <= radius_sq)
+                                visitor(std::min(order[a], order[b]), std::max(order[a], order[b]));
+                }
+            }
+        }
+
+    private:
+        double cell_size{0};
+        std::vector<Vector2> points;
+        //! Point indices grouped by cell
+        std::vector<uint32_t> order;
+        //! Cell key -> range of its points in order
+        std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> cells;
+
+        static inline uint64_t key(int64_t x, int64_t y) {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32u) | static_cast<uint32_t>(y);
+        }
+    };
+}
+
+#endif //USV_SPATIALINDEX_H
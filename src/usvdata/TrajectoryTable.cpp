@@ -0,0 +1,144 @@
+#include "TrajectoryTable.h"
+#include "Simd.h"
+
+#include <algorithm>
+
+namespace USV {
+    using Simd::Double2;
+
+    namespace {
+        template<typename T>
+        inline void evaluate_segment(T t, T sx, T sy, T vx, T vy, T ox, T oy, T omega, T angle,
+                                     T& x, T& y, T& course) {
+            T alpha = omega * t;
+            T s(0.0), c(0.0);
+            Simd::sincos(alpha, s, c);
+            x = sx + t * vx + ox - (c * ox - s * oy);
+            y = sy + t * vy + oy - (s * ox + c * oy);
+            course = angle + alpha;
+        }
+    }
+
+    TrajectoryTable::TrajectoryTable(const std::vector<PathEnvelope>& paths) {
+        size_t segments_count = 0;
+        for (const auto& pe: paths) segments_count += pe.path.size();
+        path_start_time.reserve(paths.size());
+        path_first.reserve(paths.size() + 1);
+        for (auto* v: {&end_time, &duration, &start_x, &start_y, &velocity_x, &velocity_y, &center_x, &center_y,
+                       &angular_speed, &begin_angle})
+            v->reserve(segments_count);
+
+        for (const auto& pe: paths) {
+            path_start_time.push_back(pe.path.getStartTime());
+            path_first.push_back(static_cast<uint32_t>(end_time.size()));
+            for (const auto& s: pe.path.getSegments()) {
+                const auto& segment = s.second;
+                const double speed = segment._length / segment._duration;
+                end_time.push_back(s.first);
+                duration.push_back(segment._duration);
+                start_x.push_back(segment._start_point.x());
+                start_y.push_back(segment._start_point.y());
+                begin_angle.push_back(segment._begin_angle.radians());
+                if (0.0000001 < std::abs(segment._curve)) {
+                    velocity_x.push_back(0);
+                    velocity_y.push_back(0);
+                    center_x.push_back(segment.O_V.x());
+                    center_y.push_back(segment.O_V.y());
+                    angular_speed.push_back(speed * segment._curve);
+                } else {
+                    velocity_x.push_back(segment.O_V.x());
+                    velocity_y.push_back(segment.O_V.y());
+                    center_x.push_back(0);
+                    center_y.push_back(0);
+                    angular_speed.push_back(0);
+                }
+            }
+        }
+        path_first.push_back(static_cast<uint32_t>(end_time.size()));
+        path_cursor.assign(path_first.begin(), path_first.end() - 1);
+        active_segment.resize(paths.size());
+        active_time.resize(paths.size());
+    }
+
+    void TrajectoryTable::exportRecords(double time_origin, std::vector<float>& paths,
+                                        std::vector<float>& segments) const {
+        paths.resize(pathsCount() * path_record_size);
+        for (size_t p = 0; p < pathsCount(); ++p) {
+            auto* record = paths.data() + p * path_record_size;
+            record[0] = static_cast<float>(path_start_time[p] - time_origin);
+            record[1] = static_cast<float>(path_first[p]);
+            record[2] = static_cast<float>(path_first[p + 1] - path_first[p]);
+            record[3] = 0;
+        }
+        segments.resize(segmentsCount() * segment_record_size);
+        for (size_t i = 0; i < segmentsCount(); ++i) {
+            auto* record = segments.data() + i * segment_record_size;
+            record[0] = static_cast<float>(end_time[i] - time_origin);
+            record[1] = static_cast<float>(duration[i]);
+            record[2] = static_cast<float>(start_x[i]);
+            record[3] = static_cast<float>(start_y[i]);
+            record[4] = static_cast<float>(velocity_x[i]);
+            record[5] = static_cast<float>(velocity_y[i]);
+            record[6] = static_cast<float>(center_x[i]);
+            record[7] = static_cast<float>(center_y[i]);
+            record[8] = static_cast<float>(angular_speed[i]);
+            record[9] = static_cast<float>(begin_angle[i]);
+            record[10] = 0;
+            record[11] = 0;
+        }
+    }
+
+    size_t TrajectoryTable::evaluate(double t, float* out, size_t stride, uint32_t* path_indices) const {
+        // Locate segments, same rules as Path::segment()
+        size_t n = 0;
+        for (size_t p = 0; p < path_start_time.size(); ++p) {
+            const auto first = end_time.begin() + path_first[p];
+            const auto last = end_time.begin() + path_first[p + 1];
+            if (first == last || t < path_start_time[p] || t > *(last - 1)) continue;
+            // Segment of the previous call or the next one is the usual answer during playback
+            auto segment = static_cast<size_t>(path_cursor[p]);
+            if (end_time[segment] < t && segment + 1 < path_first[p + 1]) ++segment;
+            if (end_time[segment] < t || (segment > path_first[p] && end_time[segment - 1] >= t))
+                segment = static_cast<size_t>(std::lower_bound(first, last, t) - end_time.begin());
+            path_cursor[p] = static_cast<uint32_t>(segment);
+            active_segment[n] = static_cast<uint32_t>(segment);
+            active_time[n] = std::min(t - end_time[segment] + duration[segment], duration[segment]);
+            if (path_indices) path_indices[n] = static_cast<uint32_t>(p);
+            ++n;
+        }
+
+        // Evaluate located segments two at a time
+        size_t i = 0;
+        for (; i + 1 < n; i += 2) {
+            const size_t a = active_segment[i], b = active_segment[i + 1];
+            Double2 x(0.0), y(0.0), course(0.0);
+            evaluate_segment(Double2(active_time[i], active_time[i + 1]),
+                             Double2(start_x[a], start_x[b]), Double2(start_y[a], start_y[b]),
+                             Double2(velocity_x[a], velocity_x[b]), Double2(velocity_y[a], velocity_y[b]),
+                             Double2(center_x[a], center_x[b]), Double2(center_y[a], center_y[b]),
+                             Double2(angular_speed[a], angular_speed[b]), Double2(begin_angle[a], begin_angle[b]),
+                             x, y, course);
+            double xs[2], ys[2], cs[2];
+            x.store(xs);
+            y.store(ys);
+            course.store(cs);
+            for (size_t k = 0; k < 2; ++k) {
+                float* record = out + (i + k) * stride;
+                record[0] = static_cast<float>(xs[k]);
+                record[1] = static_cast<float>(ys[k]);
+                record[2] = static_cast<float>(cs[k]);
+            }
+        }
+        if (i < n) {
+            const size_t a = active_segment[i];
+            double x, y, course;
+            evaluate_segment(active_time[i], start_x[a], start_y[a], velocity_x[a], velocity_y[a],
+                             center_x[a], center_y[a], angular_speed[a], begin_angle[a], x, y, course);
+            float* record = out + i * stride;
+            record[0] = static_cast<float>(x);
+            record[1] = static_cast<float>(y);
+            record[2] = static_cast<float>(course);
+        }
+        return n;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef USV_TRAJECTORYTABLE_H
+#define USV_TRAJECTORYTABLE_H
+
+#include "CaseData.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace USV {
+    /**
+     * \brief      Flat structure-of-arrays copy of paths segments. Evaluates positions
+     *             of all paths for a time in one pass.
+     *
+     * Segment is evaluated as start + t * V + O - R(omega * t) * O, where V is velocity
+     * of straight segment (zero for arc), O is vector from start to center of arc
+     * (zero for straight segment) and omega is angular speed.
+     */
+    class TrajectoryTable {
+    public:
+        TrajectoryTable() = default;
+
+        explicit TrajectoryTable(const std::vector<PathEnvelope>& paths);
+
+        /**
+         * \brief Evaluates positions of paths covering time t. Paths are output in order.
+         * @param t Time [sec]
+         * @param out Output records. Record i gets x, y [miles] and course [radians, not wrapped]
+         *            as three consecutive floats at out + i * stride.
+         * @param stride Distance between records in floats, at least 3
+         * @param path_indices Optional, receives index of path of each record
+         * @return Number of records written, at most pathsCount()
+         */
+        size_t evaluate(double t, float* out, size_t stride, uint32_t* path_indices = nullptr) const;
+
+        //! Floats per path record of exportRecords()
+        static constexpr size_t path_record_size = 4;
+        //! Floats per segment record of exportRecords()
+        static constexpr size_t segment_record_size = 12;
+
+        /**
+         * \brief Writes table as float records for evaluation elsewhere, e.g. on GPU. Times are
+         *        relative to time_origin to keep float precision.
+         * @param paths Per path: start time, first segment index, segments count, 0
+         * @param segments Per segment: end time, duration, start x, start y, velocity x, velocity y,
+         *                 center offset x, center offset y, angular speed, begin angle, 0, 0
+         */
+        void exportRecords(double time_origin, std::vector<float>& paths, std::vector<float>& segments) const;
+
+        [[nodiscard]] inline size_t pathsCount() const { return path_start_time.size(); }
+
+        [[nodiscard]] inline size_t segmentsCount() const { return end_time.size(); }
+
+    private:
+        // Paths, segments of path i are [path_first[i], path_first[i + 1])
+        std::vector<double> path_start_time;
+        std::vector<uint32_t> path_first;
+
+        // Segments
+        std::vector<double> end_time;
+        std::vector<double> duration;
+        std::vector<double> start_x, start_y;
+        std::vector<double> velocity_x, velocity_y;
+        std::vector<double> center_x, center_y;
+        std::vector<double> angular_speed;
+        std::vector<double> begin_angle;
+
+        // Segment found for each path by the previous evaluate()
+        mutable std::vector<uint32_t> path_cursor;
+        // Scratch of evaluate(): active segments and local times
+        mutable std::vector<uint32_t> active_segment;
+        mutable std::vector<double> active_time;
+    };
+}
+
+#endif //USV_TRAJECTORYTABLE_H
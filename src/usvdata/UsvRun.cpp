@@ -1,22 +1,357 @@
 #include "UsvRun.h"
+#include "ResultCache.h"
 
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
 #include <utility>
 
-int USV::USVRunner::run(const std::filesystem::path& directory, const USV::InputTypes::DataFilenames* data_filenames) {
-    std::string command{
-            executable.string() + " " + "--target-settings" + " " +
-            (directory / data_filenames->target_settings).string() + " " +
-            "--targets" + " " + (directory / data_filenames->navigationProblem).string() + " " +
-            "--settings" + " " + (directory / data_filenames->settings).string() + " " +
-            "--nav-data" + " " + (directory / data_filenames->navigationParameters).string() + " " +
-            "--hydrometeo" + " " + (directory / data_filenames->hydrometeo).string() + " " +
-            "--constraints" + " " + (directory / data_filenames->constraints).string() + " " +
-            "--route" + " " + (directory / data_filenames->route).string() + " " +
-            "--maneuver" + " " + (directory / data_filenames->maneuvers).string() + " " +
-            "--analyse" + " " + (directory / data_filenames->analyse).string() + " " +
-            "--predict" + " " + (directory / data_filenames->targets_paths).string()};
-    auto code = std::system(command.c_str());
-    return code;
-}
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#define USV_RUN_POSIX_SPAWN
+#ifdef __APPLE__
+#include <mutex>
+#define USV_RUN_SPAWN_LOCK
+#endif
+#endif
+
+namespace USV {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        // Time given to solver to exit after SIGTERM
+        constexpr auto kill_grace_period = std::chrono::seconds(2);
+        // Solver output beyond this isn't kept in result cache
+        constexpr size_t max_cached_log_size = 4u << 20u;
+
+        struct SolverArgument {
+            const char* flag;
+            std::string_view InputTypes::DataFilenames::* filename;
+            bool output;
+        };
+
+        constexpr SolverArgument solver_arguments[] = {
+                {"--target-settings", &InputTypes::DataFilenames::target_settings,      false},
+                {"--targets",         &InputTypes::DataFilenames::navigationProblem,    false},
+                {"--settings",        &InputTypes::DataFilenames::settings,             false},
+                {"--nav-data",        &InputTypes::DataFilenames::navigationParameters, false},
+                {"--hydrometeo",      &InputTypes::DataFilenames::hydrometeo,           false},
+                {"--constraints",     &InputTypes::DataFilenames::constraints,          false},
+                {"--route",           &InputTypes::DataFilenames::route,                false},
+                {"--maneuver",        &InputTypes::DataFilenames::maneuvers,            true},
+                {"--analyse",         &InputTypes::DataFilenames::analyse,              true},
+                {"--predict",         &InputTypes::DataFilenames::targets_paths,        true},
+        };
+
+        std::vector<ResultCache::FileArgument> file_arguments(const std::filesystem::path& directory,
+                                                              const InputTypes::DataFilenames* data_filenames,
+                                                              bool outputs) {
+            std::vector<ResultCache::FileArgument> files;
+            for (const auto& a: solver_arguments)
+                if (a.output == outputs) files.push_back({a.flag, directory / (data_filenames->*a.filename)});
+            return files;
+        }
+
+        std::vector<std::optional<std::filesystem::file_time_type>>
+        write_times(const std::vector<ResultCache::FileArgument>& files) {
+            std::vector<std::optional<std::filesystem::file_time_type>> times;
+            for (const auto& file: files) {
+                std::error_code ec;
+                const auto time = std::filesystem::last_write_time(file.path, ec);
+                times.push_back(ec ? std::nullopt : std::optional(time));
+            }
+            return times;
+        }
+
+#ifdef USV_RUN_POSIX_SPAWN
+#ifdef USV_RUN_SPAWN_LOCK
+        // Held from creating solver pipes until their write ends are closed, as there is no pipe2()
+        std::mutex spawn_mutex;
+#endif
+
+        struct Pipe {
+            int fd[2]{-1, -1};
+
+            // Children must not inherit either end, write ends are dup2'ed into the solver. Close-on-exec
+            // is set atomically, otherwise a solver spawned meanwhile by another thread could inherit
+            // the write ends and keep this solver's output open.
+            Pipe() {
+#ifdef USV_RUN_SPAWN_LOCK
+                const int created = ::pipe(fd);
+                if (created == 0) {
+                    ::fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+                    ::fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+                }
+#else
+                const int created = ::pipe2(fd, O_CLOEXEC);
+#endif
+                if (created != 0) throw std::runtime_error(std::string("pipe: ") + std::strerror(errno));
+            }
+
+            ~Pipe() {
+                closeRead();
+                closeWrite();
+            }
+
+            void closeRead() {
+                if (fd[0] >= 0) ::close(fd[0]);
+                fd[0] = -1;
+            }
+
+            void closeWrite() {
+                if (fd[1] >= 0) ::close(fd[1]);
+                fd[1] = -1;
+            }
+        };
+
+        USVRunner::Result spawn_and_wait(const std::vector<std::string>& args, const USVRunner::OutputCallback& on_output,
+                                         double timeout, const std::atomic<bool>& cancel_requested) {
+            USVRunner::Result result;
+#ifdef USV_RUN_SPAWN_LOCK
+            std::unique_lock<std::mutex> spawn_lock(spawn_mutex);
+#endif
+            Pipe out, err;
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, out.fd[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, err.fd[1], STDERR_FILENO);
+            posix_spawnattr_t attributes;
+            posix_spawnattr_init(&attributes);
+            // Own process group, so cancellation reaches solver's children too
+            posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+            posix_spawnattr_setpgroup(&attributes, 0);
+
+            std::vector<char*> argv;
+            argv.reserve(args.size() + 1);
+            for (const auto& a: args) argv.push_back(const_cast<char*>(a.c_str()));
+            argv.push_back(nullptr);
+
+            pid_t pid;
+            const int spawn_error = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+            posix_spawn_file_actions_destroy(&actions);
+            posix_spawnattr_destroy(&attributes);
+            out.closeWrite();
+            err.closeWrite();
+#ifdef USV_RUN_SPAWN_LOCK
+            spawn_lock.unlock();
+#endif
+            if (spawn_error != 0) {
+                result.error = "Failed to start " + args[0] + ": " + std::strerror(spawn_error);
+                return result;
+            }
 
-USV::USVRunner::USVRunner(std::filesystem::path  executable) : executable(std::move(executable)) {}
+            const auto start = Clock::now();
+            Clock::time_point killed_at{};
+            bool terminated = false, killed = false, reaped = false;
+            int status = 0, wait_error = 0;
+            rusage usage{};
+            pollfd fds[2] = {{out.fd[0], POLLIN, 0}, {err.fd[0], POLLIN, 0}};
+            const USVRunner::Stream streams[2] = {USVRunner::Stream::Out, USVRunner::Stream::Err};
+            char buffer[4096];
+            // Solver may close its output and keep running, so timeout and cancellation are enforced
+            // until it is reaped, not only while output is open
+            while (!reaped || fds[0].fd >= 0 || fds[1].fd >= 0) {
+                if (!terminated) {
+                    result.cancelled = cancel_requested;
+                    result.timed_out = !result.cancelled && timeout > 0 &&
+                                       std::chrono::duration<double>(Clock::now() - start).count() > timeout;
+                    if (result.cancelled || result.timed_out) {
+                        ::kill(-pid, SIGTERM);
+                        terminated = true;
+                        killed_at = Clock::now();
+                    }
+                } else if (!killed && Clock::now() - killed_at > kill_grace_period) {
+                    ::kill(-pid, SIGKILL);
+                    killed = true;
+                }
+
+                if (!reaped) {
+                    const auto waited = ::wait4(pid, &status, WNOHANG, &usage);
+                    if (waited < 0 && errno != EINTR) wait_error = errno;
+                    reaped = waited == pid || wait_error;
+                }
+
+                if (fds[0].fd < 0 && fds[1].fd < 0) {
+                    if (!reaped) ::poll(nullptr, 0, 100);
+                    continue;
+                }
+                if (::poll(fds, 2, 100) < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                for (size_t i = 0; i < 2; ++i) {
+                    if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                    const auto n = ::read(fds[i].fd, buffer, sizeof(buffer));
+                    if (n > 0) {
+                        if (on_output) on_output(streams[i], std::string(buffer, static_cast<size_t>(n)));
+                    } else if (n == 0 || errno != EINTR) {
+                        // End of output, negative fd makes poll skip the entry
+                        fds[i].fd = -1;
+                    }
+                }
+            }
+
+            if (!reaped) {
+                while (::wait4(pid, &status, 0, &usage) < 0) {
+                    if (errno == EINTR) continue;
+                    wait_error = errno;
+                    break;
+                }
+            }
+            if (wait_error) {
+                // Exit status is unknown, run must not count as success
+                result.error = "Failed to wait for " + args[0] + ": " + std::strerror(wait_error);
+                return result;
+            }
+            if (WIFEXITED(status)) result.exit_code = WEXITSTATUS(status);
+#ifdef __APPLE__
+            result.peak_rss_kib = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+            result.peak_rss_kib = usage.ru_maxrss;
+#endif
+            return result;
+        }
+#else
+        std::string quote(const std::string& arg) {
+            return "\"" + arg + "\"";
+        }
+
+        USVRunner::Result system_and_wait(const std::vector<std::string>& args) {
+            std::string command;
+            for (const auto& a: args) command += (command.empty() ? "" : " ") + quote(a);
+#ifdef _WIN32
+            // cmd.exe strips the outermost quotes of the whole command line
+            command = quote(command);
+#endif
+            USVRunner::Result result;
+            result.exit_code = std::system(command.c_str());
+            return result;
+        }
+#endif
+    }
+
+    USVRunner::USVRunner(std::filesystem::path executable)
+            : executable(std::move(executable)), result_cache(ResultCache::defaultDirectory()) {}
+
+    USVRunner::~USVRunner() {
+        cancel();
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        if (worker.joinable()) worker.join();
+    }
+
+    std::vector<std::string> USVRunner::arguments(const std::filesystem::path& directory,
+                                                  const InputTypes::DataFilenames* data_filenames) const {
+        std::vector<std::string> args{executable.string()};
+        for (const auto& a: solver_arguments) {
+            args.emplace_back(a.flag);
+            args.push_back((directory / (data_filenames->*a.filename)).string());
+        }
+        return args;
+    }
+
+    void USVRunner::setResultCache(std::filesystem::path directory) {
+        result_cache = std::move(directory);
+    }
+
+    USVRunner::Result USVRunner::run(const std::filesystem::path& directory,
+                                     const InputTypes::DataFilenames* data_filenames,
+                                     const OutputCallback& on_output, double timeout) {
+        cancel_requested = false;
+        return execute(directory, data_filenames, on_output, timeout);
+    }
+
+    USVRunner::Result USVRunner::execute(const std::filesystem::path& directory,
+                                         const InputTypes::DataFilenames* data_filenames,
+                                         const OutputCallback& on_output, double timeout) {
+        const auto args = arguments(directory, data_filenames);
+        const auto start = Clock::now();
+        Result result;
+
+        const auto outputs = file_arguments(directory, data_filenames, true);
+        std::optional<uint64_t> cache_key;
+        if (!result_cache.empty()) {
+            try {
+                cache_key = ResultCache::key(executable, file_arguments(directory, data_filenames, false));
+                std::string log;
+                if (cache_key && ResultCache::restore(result_cache, *cache_key, outputs, log)) {
+                    if (on_output && !log.empty()) on_output(Stream::Out, log);
+                    result.exit_code = 0;
+                    result.cached = true;
+                    result.wall_time = std::chrono::duration<double>(Clock::now() - start).count();
+                    return result;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "Result cache unavailable: " << e.what() << std::endl;
+                cache_key.reset();
+            }
+        }
+
+        // Only outputs written by this run are cached, not ones left from earlier runs
+        std::vector<std::optional<std::filesystem::file_time_type>> outputs_mtime;
+        if (cache_key) outputs_mtime = write_times(outputs);
+
+        std::string log;
+        const OutputCallback capture = [&](Stream stream, const std::string& chunk) {
+            if (cache_key && log.size() < max_cached_log_size) log += chunk;
+            if (on_output) on_output(stream, chunk);
+        };
+        try {
+#ifdef USV_RUN_POSIX_SPAWN
+            result = spawn_and_wait(args, capture, timeout, cancel_requested);
+#else
+            (void) capture;
+            (void) timeout;
+            result = system_and_wait(args);
+#endif
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+        result.wall_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (cache_key && result.exit_code == 0 && !result.cancelled && !result.timed_out && result.error.empty()) {
+            std::vector<ResultCache::FileArgument> written;
+            const auto mtime = write_times(outputs);
+            for (size_t i = 0; i < outputs.size(); ++i)
+                if (mtime[i] && mtime[i] != outputs_mtime[i]) written.push_back(outputs[i]);
+            try {
+                ResultCache::store(result_cache, *cache_key, written, log);
+            } catch (const std::exception& e) {
+                std::cout << "Couldn't write result cache: " << e.what() << std::endl;
+            }
+        }
+        return result;
+    }
+
+    bool USVRunner::start(const std::filesystem::path& directory, const InputTypes::DataFilenames* data_filenames,
+                          OutputCallback on_output, FinishCallback on_finish, double timeout) {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        if (busy) return false;
+        if (worker.joinable()) worker.join();
+        busy = true;
+        cancel_requested = false;
+        worker = std::thread([this, directory, data_filenames, on_output = std::move(on_output),
+                                     on_finish = std::move(on_finish), timeout] {
+            const auto result = execute(directory, data_filenames, on_output, timeout);
+            busy = false;
+            if (on_finish) on_finish(result);
+        });
+        return true;
+    }
+
+    void USVRunner::cancel() {
+        cancel_requested = true;
+    }
+}
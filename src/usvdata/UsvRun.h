@@ -3,14 +3,99 @@
 
 #include "InputTypes.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace USV {
+    /**
+     * \brief      Runs solver executable on case files.
+     *
+     * On POSIX the solver is started with posix_spawn in its own process group, its stdout
+     * and stderr are read through pipes. Elsewhere it is run with std::system, output is not
+     * captured and runs can't be cancelled.
+     *
+     * Outputs of successful runs are kept in ResultCache, runs with the same executable and
+     * input files restore them instead of starting the solver.
+     */
     class USVRunner {
-        std::filesystem::path executable;
     public:
+        enum class Stream {
+            Out,
+            Err
+        };
+
+        struct Result {
+            int exit_code{-1}; //! Exit status, -1 if solver failed to start or was killed by signal
+            bool timed_out{false};
+            bool cancelled{false};
+            std::string error{}; //! Why solver failed to start or its exit status is unknown
+            double wall_time{0}; //! Run duration [sec]
+            long peak_rss_kib{-1}; //! Solver peak resident set size, -1 if unknown
+            bool cached{false}; //! Outputs were restored from result cache, solver wasn't run
+        };
+
+        //! Receives chunks of solver output as they arrive, not split into lines
+        using OutputCallback = std::function<void(Stream, const std::string&)>;
+        using FinishCallback = std::function<void(const Result&)>;
+
         explicit USVRunner(std::filesystem::path executable);
 
-    public:
-        int run(const std::filesystem::path& directory, const InputTypes::DataFilenames* data_filenames);
+        //! Cancels run in progress and waits for it
+        ~USVRunner();
+
+        USVRunner(const USVRunner&) = delete;
+
+        USVRunner& operator=(const USVRunner&) = delete;
+
+        /**
+         * \brief Result cache directory, ResultCache::defaultDirectory() initially. Empty disables cache.
+         */
+        void setResultCache(std::filesystem::path directory);
+
+        /**
+         * \brief Solver command line for case, executable first
+         */
+        [[nodiscard]] std::vector<std::string> arguments(const std::filesystem::path& directory,
+                                                         const InputTypes::DataFilenames* data_filenames) const;
+
+        /**
+         * \brief Runs solver and waits for it. Output is passed to on_output on calling thread.
+         * @param timeout Solver is killed after timeout [sec], 0 for no timeout
+         */
+        Result run(const std::filesystem::path& directory, const InputTypes::DataFilenames* data_filenames,
+                   const OutputCallback& on_output = {}, double timeout = 0);
+
+        /**
+         * \brief Starts run() on background thread. Callbacks are called on that thread,
+         *        on_finish is called exactly once, after running() became false. It must not
+         *        call start() itself, post to own thread instead.
+         * @return false if previous run is still in progress
+         */
+        bool start(const std::filesystem::path& directory, const InputTypes::DataFilenames* data_filenames,
+                   OutputCallback on_output, FinishCallback on_finish, double timeout = 0);
+
+        /**
+         * \brief Requests cancellation of run in progress. Solver process group gets SIGTERM,
+         *        then SIGKILL if it doesn't exit within a couple of seconds.
+         */
+        void cancel();
+
+        [[nodiscard]] inline bool running() const { return busy; }
+
+    private:
+        std::filesystem::path executable;
+        std::filesystem::path result_cache;
+        std::thread worker;
+        std::mutex worker_mutex;
+        std::atomic<bool> busy{false};
+        std::atomic<bool> cancel_requested{false};
+
+        Result execute(const std::filesystem::path& directory, const InputTypes::DataFilenames* data_filenames,
+                       const OutputCallback& on_output, double timeout);
     };
 
 }
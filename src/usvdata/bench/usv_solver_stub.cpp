@@ -0,0 +1,33 @@
+/**
+ * \file       usv_solver_stub.cpp
+ * \brief      Stand-in for the solver executable, for trying USVRunner and the GUI without it.
+ *
+ * usage: usv_solver_stub [solver arguments...]
+ *
+ * Prints its arguments and progress lines to stdout and stderr, then exits.
+ * Environment: USV_STUB_SECONDS run time (default 3), USV_STUB_EXIT exit code (default 0).
+ * Case files are not modified.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char** argv) {
+    const char* seconds_env = std::getenv("USV_STUB_SECONDS");
+    const char* exit_env = std::getenv("USV_STUB_EXIT");
+    const double seconds = seconds_env ? std::atof(seconds_env) : 3.0;
+    const int exit_code = exit_env ? std::atoi(exit_env) : 0;
+
+    std::cout << "usv_solver_stub";
+    for (int i = 1; i < argc; ++i) std::cout << ' ' << argv[i];
+    std::cout << std::endl;
+
+    const int steps = 10;
+    for (int i = 1; i <= steps; ++i) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds / steps));
+        std::cout << "progress " << i * 100 / steps << "%" << std::endl;
+        if (i % 5 == 0) std::cerr << "warning: stub step " << i << std::endl;
+    }
+    return exit_code;
+}
@@ -0,0 +1,492 @@
+/**
+ * \file       usvdata_bench.cpp
+ * \brief      Microbenchmarks of usvdata hot kernels. Results are written as JSON.
+ *
+ * usage: usvdata_bench [--out results.json] [--filter substring] [case_dir...]
+ *        usvdata_bench --load-once case_dir
+ *        usvdata_bench --decode-once stringstream|mapped constraints.json
+ *        usvdata_bench --check
+ *
+ * Synthetic data is generated with fixed seed so runs are comparable between builds.
+ * Given case directories are additionally used for loading benchmarks and path kernels.
+ * --load-once loads case once and reports wall time and peak resident set size of the
+ * process, run it in a fresh process for each build to compare memory footprint of loading.
+ * --decode-once does the same for decoding one constraints file through the previous
+ * stringstream reading path or through the mapped file, so both are compared in one build.
+ * Accuracy checks run before benchmarks, or alone with --check; exit code is 1 if one fails.
+ */
+#include "../InputUtils.h"
+#include "../CaseData.h"
+#include "../Path.h"
+#include "../Frame.h"
+#include "../Restrictions.h"
+#include "../TrajectoryTable.h"
+#include "../MappedFile.h"
+#include "../InputDataJsonDefines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Minimal time per repetition
+    constexpr double min_repetition_time = 0.1; // [sec]
+    constexpr int repetitions = 5;
+
+    template<typename T>
+    inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        size_t items; //! Items processed by single call
+        size_t iterations; //! Calls per repetition
+        double ns_per_call_median;
+        double ns_per_call_min;
+    };
+
+    class Runner {
+        std::string filter;
+        std::vector<Result> results;
+    public:
+        explicit Runner(std::string filter) : filter(std::move(filter)) {}
+
+        /**
+         * Run benchmark
+         * @param name Unique benchmark name
+         * @param items Number of items processed by one call of f
+         * @param f Benchmarked call
+         */
+        void run(const std::string& name, size_t items, const std::function<void()>& f) {
+            if (!filter.empty() && name.find(filter) == std::string::npos) return;
+            // Calibrate number of iterations
+            size_t iterations = 1;
+            for (;;) {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) f();
+                std::chrono::duration<double> elapsed = Clock::now() - start;
+                if (elapsed.count() >= min_repetition_time || iterations >= (1u << 30u)) break;
+                iterations = elapsed.count() < min_repetition_time / 100 ? iterations * 10 : iterations * 2;
+            }
+            std::vector<double> times;
+            for (int r = 0; r < repetitions; ++r) {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) f();
+                std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+                times.push_back(elapsed.count() / static_cast<double>(iterations));
+            }
+            std::sort(times.begin(), times.end());
+            results.push_back({name, items, iterations, times[times.size() / 2], times.front()});
+            std::cerr << name << ": " << times[times.size() / 2] << " ns/call" << std::endl;
+        }
+
+        void write_json(std::ostream& os) const {
+            os << "{\n  \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const auto& r = results[i];
+                os << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"items\": " << r.items
+                   << ", \"iterations\": " << r.iterations << ", \"ns_per_call\": " << r.ns_per_call_median
+                   << ", \"ns_per_call_min\": " << r.ns_per_call_min << ", \"ns_per_item\": "
+                   << r.ns_per_call_median / static_cast<double>(std::max<size_t>(r.items, 1)) << "}";
+            }
+            os << "\n  ]\n}\n";
+        }
+    };
+
+    USV::Path synthetic_path(std::mt19937& rng, size_t segments_count) {
+        std::uniform_real_distribution<double> duration(60, 1200);
+        std::uniform_real_distribution<double> curve(0.5, 2.0);
+        USV::Path path(1600000000);
+        USV::Path::Position position{{0, 0}, 0, 10.0 / 3600};
+        for (size_t i = 0; i < segments_count; ++i) {
+            USV::Path::Segment segment = (i % 2) ? USV::Path::Segment(position, (i % 4 == 1 ? 1 : -1) * curve(rng),
+                                                                      USV::Angle(M_PI_4))
+                                                 : USV::Path::Segment(position, 0.0, duration(rng));
+            path.appendSegment(segment);
+            position = segment.end();
+        }
+        return path;
+    }
+
+    USV::Restrictions::Polygon synthetic_polygon(std::mt19937& rng, size_t vertices_count) {
+        std::uniform_real_distribution<double> radius(2, 6);
+        USV::Restrictions::Polygon polygon;
+        polygon.rings.emplace_back();
+        for (size_t i = 0; i < vertices_count; ++i)
+            polygon.rings[0].push_back(USV::Vector2::polar(radius(rng), M_2PI * i / vertices_count));
+        // a hole
+        polygon.rings.emplace_back();
+        for (size_t i = 0; i < vertices_count / 10 + 3; ++i)
+            polygon.rings[1].push_back(USV::Vector2::polar(1, -M_2PI * i / (vertices_count / 10 + 3)));
+        return polygon;
+    }
+
+    std::vector<double> sample_times(std::mt19937& rng, const USV::Path& path, size_t n) {
+        std::uniform_real_distribution<double> t(path.getStartTime(), path.endTime());
+        std::vector<double> times(n);
+        for (auto& v: times) v = t(rng);
+        return times;
+    }
+
+    std::vector<USV::Vector2> sample_points(std::mt19937& rng, size_t n, double spread) {
+        std::uniform_real_distribution<double> c(-spread, spread);
+        std::vector<USV::Vector2> points(n);
+        for (auto& p: points) p = {c(rng), c(rng)};
+        return points;
+    }
+
+    void bench_path(Runner& runner, const std::string& prefix, const USV::Path& path, std::mt19937& rng) {
+        if (path.empty()) return;
+        const auto times = sample_times(rng, path, 1024);
+        runner.run(prefix + "Path::position", times.size(), [&] {
+            for (auto t: times) do_not_optimize(path.position(t));
+        });
+        runner.run(prefix + "Path::segment", times.size(), [&] {
+            for (auto t: times) do_not_optimize(path.segment(t));
+        });
+        auto sorted_times = times;
+        std::sort(sorted_times.begin(), sorted_times.end());
+        runner.run(prefix + "Path::position/monotonic", sorted_times.size(), [&] {
+            for (auto t: sorted_times) do_not_optimize(path.position(t));
+        });
+        runner.run(prefix + "Path::Cursor::position/monotonic", sorted_times.size(), [&] {
+            USV::Path::Cursor cursor(path);
+            for (auto t: sorted_times) do_not_optimize(cursor.position(t));
+        });
+        std::vector<std::optional<USV::Path::Position>> sampled(sorted_times.size());
+        runner.run(prefix + "Path::sample/monotonic", sorted_times.size(), [&] {
+            path.sample(sorted_times.data(), sorted_times.size(), sampled.data());
+            do_not_optimize(sampled.data());
+        });
+        const auto points = sample_points(rng, 64, 20);
+        runner.run(prefix + "Path::closestSegment", points.size(), [&] {
+            for (const auto& p: points) do_not_optimize(path.closestSegment(p));
+        });
+    }
+
+    void bench_trajectories(Runner& runner, const std::string& prefix, const std::vector<USV::PathEnvelope>& paths,
+                            double min_time, double max_time) {
+        const USV::TrajectoryTable table(paths);
+        std::vector<float> out(paths.size() * 7);
+        std::vector<uint32_t> indices(paths.size());
+        const double t = 0.5 * (min_time + max_time);
+        runner.run(prefix + "TrajectoryTable::evaluate", paths.size(), [&] {
+            do_not_optimize(table.evaluate(t, out.data(), 7, indices.data()));
+        });
+        runner.run(prefix + "Path::tryPosition/all_paths", paths.size(), [&] {
+            for (const auto& pe: paths) do_not_optimize(pe.path.tryPosition(t));
+        });
+    }
+
+    void bench_synthetic(Runner& runner) {
+        std::mt19937 rng(42);
+        for (size_t n: {16, 256, 4096}) {
+            auto path = synthetic_path(rng, n);
+            bench_path(runner, "synthetic/" + std::to_string(n) + "/", path, rng);
+        }
+        {
+            auto path = synthetic_path(rng, 64);
+            const auto points = sample_points(rng, 1024, 20);
+            for (const auto& s: path.getSegments()) {
+                const auto& segment = s.second;
+                const auto name = std::string("synthetic/Segment::distance_signed/") +
+                                  (std::abs(segment.getCurve()) > 0 ? "arc" : "straight");
+                runner.run(name, points.size(), [&] {
+                    for (const auto& p: points) do_not_optimize(segment.distance_signed(p));
+                });
+                if (std::abs(segment.getCurve()) > 0) break;
+            }
+        }
+        {
+            const USV::Frame frame(59.9, 30.3);
+            std::uniform_real_distribution<double> d(-0.5, 0.5);
+            std::vector<std::pair<double, double>> coordinates(1024);
+            for (auto& c: coordinates) c = {frame.getRefLat() + d(rng), frame.getRefLon() + d(rng)};
+            runner.run("synthetic/Frame::fromWgs", coordinates.size(), [&] {
+                for (const auto& c: coordinates) do_not_optimize(frame.fromWgs(c.first, c.second));
+            });
+            std::vector<USV::LatLon> lat_lon(coordinates.size());
+            for (size_t i = 0; i < coordinates.size(); ++i)
+                lat_lon[i] = {coordinates[i].first, coordinates[i].second};
+            std::vector<USV::Vector2> local(lat_lon.size());
+            runner.run("synthetic/Frame::fromWgs/batch_geodesic", lat_lon.size(), [&] {
+                frame.fromWgs(lat_lon.data(), lat_lon.size(), local.data(), USV::Frame::Projection::Geodesic);
+                do_not_optimize(local.data());
+            });
+            runner.run("synthetic/Frame::fromWgs/batch_local", lat_lon.size(), [&] {
+                frame.fromWgs(lat_lon.data(), lat_lon.size(), local.data(), USV::Frame::Projection::Local);
+                do_not_optimize(local.data());
+            });
+            const auto points = sample_points(rng, 1024, 30);
+            runner.run("synthetic/Frame::toWgs", points.size(), [&] {
+                double lat, lon;
+                for (const auto& p: points) {
+                    frame.toWgs(p, lat, lon);
+                    do_not_optimize(lat);
+                    do_not_optimize(lon);
+                }
+            });
+        }
+        {
+            std::vector<USV::PathEnvelope> paths;
+            for (size_t i = 0; i < 4096; ++i)
+                paths.emplace_back(USV::PathType::TargetManeuver, nullptr, synthetic_path(rng, 16));
+            double max_time = 0;
+            for (const auto& pe: paths) max_time = std::max(max_time, pe.path.endTime());
+            bench_trajectories(runner, "synthetic/4096_paths/", paths, paths.front().path.getStartTime(), max_time);
+        }
+        {
+            // Many small zones, as in ENC-derived cases
+            USV::Restrictions::Restrictions restrictions;
+            std::uniform_real_distribution<double> c(-100, 100);
+            for (size_t i = 0; i < 20000; ++i) {
+                auto polygon = synthetic_polygon(rng, 16);
+                const USV::Vector2 center{c(rng), c(rng)};
+                for (auto& ring: polygon.rings)
+                    for (auto& p: ring) p = center + p * 0.2;
+                restrictions.soft.add_movement_parameters_limitation(polygon, nullptr);
+            }
+            restrictions.buildIndex();
+            const auto points = sample_points(rng, 256, 100);
+            runner.run("synthetic/20000_zones/Restrictions::zonesAt", points.size(), [&] {
+                for (const auto& p: points) do_not_optimize(restrictions.zonesAt(p));
+            });
+            runner.run("synthetic/20000_zones/pointInPolygon_scan", points.size(), [&] {
+                for (const auto& p: points)
+                    for (const auto& zone: restrictions.soft.MovementParametersLimitations())
+                        do_not_optimize(USV::Restrictions::pointInPolygon(zone.polygon, p));
+            });
+            runner.run("synthetic/20000_zones/Restrictions::nearest", points.size(), [&] {
+                for (const auto& p: points) do_not_optimize(restrictions.nearest(p));
+            });
+        }
+        for (size_t n: {32, 1024, 32768}) {
+            const auto polygon = synthetic_polygon(rng, n);
+            const auto points = sample_points(rng, 256, 7);
+            runner.run("synthetic/" + std::to_string(n) + "/Restrictions::pointInPolygon", points.size(), [&] {
+                for (const auto& p: points) do_not_optimize(USV::Restrictions::pointInPolygon(polygon, p));
+            });
+            auto indexed = polygon;
+            indexed.buildEdgeTables();
+            runner.run("synthetic/" + std::to_string(n) + "/Restrictions::containsPoints", points.size(), [&] {
+                do_not_optimize(USV::Restrictions::containsPoints(indexed, points));
+            });
+        }
+    }
+
+    /**
+     * Compares Frame::Projection::Local with exact geodesic on grids around reference points
+     * up to 84 degrees of latitude, against the bounds documented in Frame::Projection
+     * @return Whether all deviations are within bounds
+     */
+    bool check_frame_local() {
+        struct Bound {
+            double radius; // [deg] of latitude and of parallel arc
+            double max_error; // [m]
+        };
+        constexpr Bound bounds[] = {{0.5, 0.012}, {1.0, 0.1}};
+        constexpr int steps = 10;
+        constexpr double nautical_mile = 1852.0;
+        bool ok = true;
+        for (const auto& bound: bounds) {
+            double max_error = 0;
+            for (int ref_lat = -84; ref_lat <= 84; ref_lat += 6) {
+                const USV::Frame frame(ref_lat, 30.0);
+                const double lon_scale = 1 / std::max(std::cos(ref_lat * M_PI / 180), 0.1);
+                std::vector<USV::LatLon> lat_lon;
+                for (int i = -steps; i <= steps; ++i)
+                    for (int j = -steps; j <= steps; ++j)
+                        lat_lon.push_back({ref_lat + bound.radius * i / steps,
+                                           30.0 + bound.radius * j / steps * lon_scale});
+                const auto local = frame.fromWgs(lat_lon, USV::Frame::Projection::Local);
+                const auto exact = frame.fromWgs(lat_lon, USV::Frame::Projection::Geodesic);
+                for (size_t k = 0; k < lat_lon.size(); ++k)
+                    max_error = std::max(max_error, USV::abs(local[k] - exact[k]) * nautical_mile);
+            }
+            std::cerr << "Frame::Projection::Local within " << bound.radius << " deg: max deviation "
+                      << max_error << " m (bound " << bound.max_error << " m)" << std::endl;
+            ok = ok && max_error <= bound.max_error;
+        }
+        return ok;
+    }
+
+    //! Peak resident set size of the process [KiB], -1 if unknown
+    long peak_rss_kib() {
+#if defined(__APPLE__)
+        rusage usage{};
+        return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss / 1024 : -1;
+#elif defined(__unix__)
+        rusage usage{};
+        return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+#else
+        return -1;
+#endif
+    }
+
+    //! Previous loading path: stream into stringstream, then copy out as string
+    std::string read_stringstream(const std::filesystem::path& filename) {
+        std::ifstream ifs(filename);
+        std::stringstream buffer;
+        buffer << ifs.rdbuf();
+        return buffer.str();
+    }
+
+    /**
+     * Decode constraints file as load_from_json_file does
+     * @param mapped Decode from mapped file, else from string read by read_stringstream
+     * @return Number of decoded features
+     */
+    size_t decode_constraints(const std::filesystem::path& filename, bool mapped) {
+        USV::FeatureCollection constraints;
+        bool decoded;
+        if (mapped) {
+            const USV::MappedFile file(filename);
+            decoded = spotify::json::try_decode(constraints, file.data(), file.size());
+        } else {
+            const auto contents = read_stringstream(filename);
+            decoded = spotify::json::try_decode(constraints, contents.data(), contents.size());
+        }
+        if (!decoded) throw std::runtime_error("Failed to parse " + filename.string());
+        return constraints.features.size();
+    }
+
+    void bench_file_read(Runner& runner, const std::string& prefix, const std::filesystem::path& filename) {
+        const auto size = static_cast<size_t>(std::filesystem::file_size(filename));
+        const auto name = prefix + "read/" + filename.filename().string();
+        runner.run(name + "/stringstream", size, [&] {
+            const auto contents = read_stringstream(filename);
+            do_not_optimize(contents.data());
+        });
+        runner.run(name + "/mapped", size, [&] {
+            USV::MappedFile file(filename);
+            // Touch every page, as decoder does
+            size_t sum = 0;
+            for (size_t i = 0; i < file.size(); i += 4096) sum += static_cast<unsigned char>(file.data()[i]);
+            do_not_optimize(sum);
+        });
+    }
+
+    void bench_constraints_decode(Runner& runner, const std::string& prefix, const std::filesystem::path& filename) {
+        const auto size = static_cast<size_t>(std::filesystem::file_size(filename));
+        const auto name = prefix + "decode/" + filename.filename().string();
+        runner.run(name + "/stringstream", size, [&] {
+            do_not_optimize(decode_constraints(filename, false));
+        });
+        runner.run(name + "/mapped", size, [&] {
+            do_not_optimize(decode_constraints(filename, true));
+        });
+    }
+
+    void bench_case(Runner& runner, const std::string& directory) {
+        const auto prefix = "case/" + std::filesystem::path(directory).filename().string() + "/";
+        for (const auto& entry: std::filesystem::directory_iterator(directory))
+            if (entry.is_regular_file() && entry.path().extension() == ".json") {
+                bench_file_read(runner, prefix, entry.path());
+                if (entry.path().filename() == "constraints.json")
+                    bench_constraints_decode(runner, prefix, entry.path());
+            }
+        runner.run(prefix + "InputUtils::loadInputData", 1, [&] {
+            do_not_optimize(USV::InputUtils::loadInputData(directory));
+        });
+        const auto input_data = USV::InputUtils::loadInputData(directory);
+        runner.run(prefix + "CaseData::CaseData", 1, [&] {
+            USV::CaseData case_data(input_data);
+            do_not_optimize(case_data);
+        });
+        USV::CaseData case_data(input_data);
+        std::mt19937 rng(42);
+        const auto longest = std::max_element(case_data.paths.begin(), case_data.paths.end(),
+                                              [](const auto& a, const auto& b) {
+                                                  return a.path.size() < b.path.size();
+                                              });
+        if (longest != case_data.paths.end())
+            bench_path(runner, prefix, longest->path, rng);
+        bench_trajectories(runner, prefix, case_data.paths, case_data.min_time, case_data.max_time);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string out;
+    std::string filter;
+    std::vector<std::string> cases;
+    if (argc == 3 && !strcmp(argv[1], "--load-once")) {
+        const auto start = Clock::now();
+        const auto input_data = USV::InputUtils::loadInputData(argv[2]);
+        const auto load_time = std::chrono::duration<double>(Clock::now() - start).count();
+        do_not_optimize(input_data);
+        std::cerr << "{\"load_time_s\": " << load_time << ", \"peak_rss_kib\": " << peak_rss_kib() << "}"
+                  << std::endl;
+        return 0;
+    }
+    if (argc == 4 && !strcmp(argv[1], "--decode-once") &&
+        (!strcmp(argv[2], "stringstream") || !strcmp(argv[2], "mapped"))) {
+        const auto start = Clock::now();
+        const auto features = decode_constraints(argv[3], !strcmp(argv[2], "mapped"));
+        const auto decode_time = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cerr << "{\"read\": \"" << argv[2] << "\", \"features\": " << features << ", \"decode_time_s\": "
+                  << decode_time << ", \"peak_rss_kib\": " << peak_rss_kib() << "}" << std::endl;
+        return 0;
+    }
+    if (argc == 2 && !strcmp(argv[1], "--check")) return check_frame_local() ? 0 : 1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out = argv[++i];
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (argv[i][0] == '-') {
+            std::cerr << "usage: usvdata_bench [--out results.json] [--filter substring] [case_dir...]\n"
+                         "       usvdata_bench --load-once case_dir\n"
+                         "       usvdata_bench --decode-once stringstream|mapped constraints.json\n"
+                         "       usvdata_bench --check" << std::endl;
+            return 2;
+        } else {
+            cases.emplace_back(argv[i]);
+        }
+    }
+
+    // Loading messages go to stdout, keep it out of results
+    std::stringstream discard;
+    auto cout_buf = std::cout.rdbuf(discard.rdbuf());
+
+    const bool checks_passed = check_frame_local();
+    Runner runner(filter);
+    bench_synthetic(runner);
+    for (const auto& directory: cases) {
+        try {
+            bench_case(runner, directory);
+        } catch (std::exception& e) {
+            std::cerr << "Skipping " << directory << ": " << e.what() << std::endl;
+        }
+        discard.str({});
+    }
+    std::cout.rdbuf(cout_buf);
+
+    if (out.empty()) {
+        runner.write_json(std::cout);
+    } else {
+        std::ofstream ofs(out);
+        runner.write_json(ofs);
+    }
+    return checks_passed ? 0 : 1;
+}